@@ -0,0 +1,16 @@
+#include "bench_json.hpp"
+
+int main() {
+    bench_binding();
+    bench_extract();
+    bench_format();
+    bench_lines();
+    bench_lookup();
+    bench_numbers();
+    bench_parse();
+    bench_query();
+    bench_serialize();
+    bench_strings();
+    bench_validate();
+    return 0;
+}
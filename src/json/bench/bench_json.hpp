@@ -0,0 +1,360 @@
+#ifndef BENCH_JSON_HPP
+#define BENCH_JSON_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json/json.hpp"
+
+static std::size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    ++allocations;
+    const std::size_t a = static_cast<std::size_t>(alignment);
+    if (void *p = std::aligned_alloc(a, (size + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+
+// out of line, once inlined GCC sees operator new paired with free and warns
+[[gnu::noinline]] void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+[[gnu::noinline]] void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+template <typename function>
+static void measure(const char *name, const std::size_t bytes, const int iterations, function &&f) {
+    using clock = std::chrono::steady_clock;
+    const std::size_t before = allocations;
+    const auto start = clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        f();
+    }
+    const std::chrono::duration<double> elapsed = clock::now() - start;
+    const double seconds = elapsed.count() / iterations;
+    std::printf("%-32s %12zu allocations %10.3f ms %10.1f MB/s\n", name,
+                (allocations - before) / iterations, seconds * 1e3, bytes / seconds / 1e6);
+}
+
+static std::string make_records(const int n) {
+    std::string s = "[";
+    for (int i = 0; i < n; ++i) {
+        s += i == 0 ? "" : ",";
+        s += R"({"id":)" + std::to_string(i) + R"(,"name":"record number )" + std::to_string(i);
+        s += R"(","tags":["alpha","beta","gamma"],"active":true,"score":)" + std::to_string(i * 0.25);
+        s += R"(,"address":{"city":"Springfield","street":"Evergreen Terrace","zip":12345}})";
+    }
+    s += "]";
+    return s;
+}
+
+struct bench_address final {
+    std::string city;
+    std::string street;
+    int zip = 0;
+};
+
+JSON_FIELDS(bench_address, city, street, zip);
+
+struct bench_record final {
+    std::int64_t id = 0;
+    std::string name;
+    std::vector<std::string> tags;
+    bool active = false;
+    double score = 0;
+    bench_address address;
+};
+
+JSON_FIELDS(bench_record, id, name, tags, active, score, address);
+
+void bench_binding() {
+    const std::string data = make_records(100000);
+    constexpr int iterations = 5;
+
+    measure("binding/document", data.size(), iterations, [&data] {
+        json::document doc{data};
+    });
+    measure("binding/structs", data.size(), iterations, [&data] {
+        const auto records = json::parse<std::vector<bench_record>>(data);
+    });
+
+    const json::value v = json::parse(data);
+    const auto records = json::parse<std::vector<bench_record>>(data);
+    measure("binding/serialize value", data.size(), iterations, [&v, &data] {
+        std::string out;
+        out.reserve(data.size());
+        json::serialize(v, out);
+    });
+    measure("binding/serialize structs", data.size(), iterations, [&records, &data] {
+        std::string out;
+        out.reserve(data.size());
+        json::serialize(records, out);
+    });
+}
+
+static std::string make_lines(const int n) {
+    std::string s;
+    for (int i = 0; i < n; ++i) {
+        s += R"({"id":)" + std::to_string(i) + R"(,"name":"record number )" + std::to_string(i);
+        s += R"(","tags":["alpha","beta","gamma"],"active":true,"score":)" + std::to_string(i * 0.25);
+        s += R"(,"address":{"city":"Springfield","street":"Evergreen Terrace","zip":12345}})" "\n";
+    }
+    return s;
+}
+
+void bench_lines() {
+    const std::string data = make_lines(100000);
+    constexpr int iterations = 5;
+
+    measure("lines/1 thread", data.size(), iterations, [&data] {
+        json::parse_lines(data, [](json::value &&) {}, 1);
+    });
+    measure("lines/all threads", data.size(), iterations, [&data] {
+        json::parse_lines(data, [](json::value &&) {});
+    });
+}
+
+void bench_lookup() {
+    const json::value v = json::parse(make_records(1000));
+    const json::key address{"address"};
+    const json::key city{"city"};
+    constexpr int iterations = 1000;
+    std::size_t total = 0;
+
+    measure("lookup/string_view", 0, iterations, [&v, &total] {
+        for (const auto &r : v.as_array()) {
+            total += r.as_object().get("address")->as_object().get("city")->as_string().get_value().size();
+        }
+    });
+    measure("lookup/key", 0, iterations, [&v, &address, &city, &total] {
+        for (const auto &r : v.as_array()) {
+            total += r.as_object().get(address)->as_object().get(city)->as_string().get_value().size();
+        }
+    });
+    std::printf("%-32s %12zu characters\n", "lookup/total", total);
+}
+
+void bench_numbers() {
+    std::string data = "[";
+    for (int i = 0; i < 200000; ++i) {
+        data += i == 0 ? "" : ",";
+        data += std::to_string(i * 7919) + ",-" + std::to_string(i % 1000) + "." + std::to_string(i % 97);
+        data += "," + std::to_string(i) + ".25e-3";
+    }
+    data += "]";
+    constexpr int iterations = 5;
+
+    measure("numbers/document", data.size(), iterations, [&data] {
+        json::document doc{data};
+    });
+}
+
+void bench_format() {
+    std::vector<double> values;
+    for (int i = 0; i < 1000000; ++i) {
+        values.push_back(i * 1.000001 / 7);
+    }
+    constexpr int iterations = 5;
+    std::size_t bytes = 0;
+
+    measure("format/ostream", values.size() * sizeof(double), iterations, [&values, &bytes] {
+        std::ostringstream out;
+        for (const double d : values) {
+            out << std::setprecision(17) << d << ',';
+        }
+        bytes = out.str().size();
+    });
+    measure("format/to_chars", values.size() * sizeof(double), iterations, [&values, &bytes] {
+        std::string out;
+        out.reserve(bytes);
+        char str[json::number::max_chars];
+        for (const double d : values) {
+            out.append(str, json::number{d}.to_chars(str, str + sizeof(str)) - str).push_back(',');
+        }
+    });
+}
+
+void bench_strings() {
+    std::string data = "[";
+    for (int i = 0; i < 20000; ++i) {
+        data += i == 0 ? "\"" : ",\"";
+        data += "2024-01-01T00:00:00Z INFO request handled path=/api/v1/items/" + std::to_string(i);
+        data += " status=200 duration=12ms user_agent=Mozilla/5.0 (X11; Linux x86_64) message=ok";
+        data += i % 10 == 0 ? "\\n\"" : "\"";
+    }
+    data += "]";
+    const json::value v = json::parse(data);
+    constexpr int iterations = 20;
+
+    measure("strings/document", data.size(), iterations, [&data] {
+        json::document doc{data};
+    });
+    measure("strings/document (pinned)", data.size(), iterations, [&data] {
+        json::document doc{data, json::pinned};
+    });
+    measure("strings/serialize", data.size(), iterations, [&v, &data] {
+        std::string out;
+        out.reserve(data.size());
+        json::serialize(v, out);
+    });
+
+    std::string text;
+    while (text.size() < (1 << 24)) {
+        text += "ascii text, caf\xc3\xa9, \xe2\x82\xac 10, \xf0\x9f\x98\x80 ";
+    }
+    // the first character changes so that the checks aren't hoisted out of the loop
+    std::size_t valid = 0;
+    measure("strings/utf8 scalar", text.size(), iterations, [&text, &valid] {
+        text[0] = static_cast<char>('a' + valid % 2);
+        valid += utf8::is_valid<utf8::scalar_checker>(text);
+    });
+    measure("strings/utf8", text.size(), iterations, [&text, &valid] {
+        text[0] = static_cast<char>('a' + valid % 2);
+        valid += utf8::is_valid(text);
+    });
+    std::printf("%-32s %12zu valid\n", "strings/utf8 result", valid);
+}
+
+void bench_query() {
+    const std::string data = R"({"items":)" + make_records(1000) + "}";
+    const json::value v = json::parse(data);
+    const json::query q = json::compile("$.items[*].address.zip");
+    constexpr int iterations = 1000;
+    std::int64_t total = 0;
+
+    measure("query/get with strings", 0, iterations, [&v, &total] {
+        for (const auto &r : v.as_object().get(std::string{"items"})->as_array()) {
+            total += r.as_object().get(std::string{"address"})->as_object().get(std::string{"zip"})->as_number().to_long();
+        }
+    });
+    measure("query/compiled", 0, iterations, [&v, &q, &total] {
+        q.run(v, [&total](const json::value &zip) {
+            total += zip.as_number().to_long();
+        });
+    });
+    measure("query/compiled on the input", data.size(), 20, [&data, &q, &total] {
+        for (const json::value &zip : q.run(data)) {
+            total += zip.as_number().to_long();
+        }
+    });
+    std::printf("%-32s %12lld total\n", "query/total", static_cast<long long>(total));
+}
+
+void bench_serialize() {
+    const std::string data = make_records(100000);
+    const json::value v = json::parse(data);
+    constexpr int iterations = 5;
+
+    measure("serialize/print", data.size(), iterations, [&v] {
+        std::ostringstream out;
+        v.print(out);
+    });
+    measure("serialize/serialize", data.size(), iterations, [&v, &data] {
+        std::string out;
+        out.reserve(data.size());
+        json::serialize(v, out);
+    });
+    measure("serialize/pretty_print", data.size(), iterations, [&v] {
+        std::ostringstream out;
+        v.pretty_print(out);
+    });
+    measure("serialize/pretty_serialize", data.size(), iterations, [&v] {
+        std::string out;
+        json::pretty_serialize(v, out);
+    });
+}
+
+void bench_parse() {
+    const std::string data = make_records(100000);
+    constexpr int iterations = 5;
+
+    measure("parse/heap (parse + free)", data.size(), iterations, [&data] {
+        json::value v = json::parse(data);
+    });
+    measure("parse/heap all threads", data.size(), iterations, [&data] {
+        json::value v = json::parse(data, 0);
+    });
+    measure("parse/heap 4 threads", data.size(), iterations, [&data] {
+        json::value v = json::parse(data, 4);
+    });
+    measure("parse/document (parse + free)", data.size(), iterations, [&data] {
+        json::document doc{data};
+    });
+    measure("parse/document pinned", data.size(), iterations, [&data] {
+        json::document doc{data, json::pinned};
+    });
+
+
+    std::vector<json::value> values;
+    for (int i = 0; i < iterations; ++i) {
+        values.push_back(json::parse(data));
+    }
+    measure("free/heap", data.size(), iterations, [&values] {
+        values.pop_back();
+    });
+}
+
+void bench_validate() {
+    const std::string data = make_records(100000);
+    constexpr int iterations = 5;
+    bool ok = true;
+
+    measure("validate/parse", data.size(), iterations, [&data] {
+        json::value v = json::parse(data);
+    });
+    measure("validate/sax", data.size(), iterations, [&data] {
+        json::sax_handler h;
+        json::sax_parse(data, h);
+    });
+    measure("validate/validate", data.size(), iterations, [&data, &ok] {
+        ok = ok && json::validate(data).ok();
+    });
+    std::printf("%-32s %12s\n", "validate/result", ok ? "ok" : "invalid");
+}
+
+void bench_extract() {
+    std::string data = R"({"user":{"id":7,"name":"someone"},"event":{"ts":1700000000123},"payload":)";
+    data += make_records(200);
+    data += "}";
+    constexpr int iterations = 1000;
+
+    measure("extract/parse (2 fields)", data.size(), iterations, [&data] {
+        json::value v = json::parse(data);
+    });
+    measure("extract/extract (2 fields)", data.size(), iterations, [&data] {
+        const auto fields = json::extract(data, {"/user/id", "/event/ts"});
+    });
+    measure("extract/extract (last field)", data.size(), iterations, [&data] {
+        const auto fields = json::extract(data, {"/payload/199/id"});
+    });
+}
+
+#endif
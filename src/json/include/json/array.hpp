@@ -1,55 +1,308 @@
 #ifndef JSON_ARRAY_HPP
 #define JSON_ARRAY_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
 #include <ostream>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <variant>
 #include <vector>
 
+#include "number.hpp"
+#include "tag.hpp"
 #include "utils.hpp"
 
 namespace json::tmp {
 
+// Arrays holding only integers, only reals or only booleans are stored
+// unboxed, any other element turns the storage into values, so a number
+// keeps its kind whatever follows it.
+// get and the iterators of a mutable array convert typed storage to values
+// first, the ones of a const array never write: they give elements, which
+// refer to the values or hold a copy of a typed element.
 template <typename value>
 class array final {
 public:
+    enum class storage: std::uint8_t {
+        values,
+        integers,
+        reals,
+        booleans
+    };
+
     template <typename ...types>
-    array(types &&...args): values{std::forward<types>(args)...} {}
+    requires (!(sizeof...(types) == 1 && (std::is_same_v<std::remove_cvref_t<types>, array> && ...)))
+    array(types &&...args): array{std::pmr::get_default_resource()} {
+        (add(value{std::forward<types>(args)}), ...);
+    }
 
-    inline array &add(const value &&v) {
-        values.push_back(v);
+    array(std::pmr::memory_resource *resource):
+        data{std::pmr::polymorphic_allocator<>{resource}.new_object<values_t>()} {}
+
+    array(const array &a): array{} {
+        a.visit([this](const auto &elements) {
+            reset<std::remove_cvref_t<decltype(elements)>>(std::pmr::get_default_resource()) = elements;
+        });
+        mode = a.mode;
+    }
+
+    // a moved from array is empty and allocates again when added to
+    array(array &&a) noexcept:
+        mode{std::exchange(a.mode, storage::values)},
+        data{std::exchange(a.data, nullptr)} {}
+
+    ~array() {
+        destroy();
+    }
+
+    array &operator=(const array &a) {
+        array tmp{a};
+        swap(tmp);
         return *this;
     }
 
-    inline array &add(value &&v) {
-        values.push_back(std::move(v));
+    array &operator=(array &&a) noexcept {
+        array tmp{std::move(a)};
+        swap(tmp);
         return *this;
     }
 
-    inline auto size() const {
-        return values.size();
+    inline array &add(const value &&v) {
+        value copy = v;
+        return add(std::move(copy));
+    }
+
+    array &add(value &&v) {
+        if (!data) {
+            to_values();
+        }
+        switch (mode) {
+        case storage::values:
+            if (as<values_t>().empty() && (v.is_number() || v.is_boolean())) {
+                start(v);
+            } else {
+                as<values_t>().push_back(std::move(v));
+            }
+            return *this;
+        case storage::integers:
+            if (v.is_number() && v.as_number().is_integer()) {
+                as<integers_t>().push_back(v.as_number().to_long());
+                return *this;
+            }
+            break;
+        case storage::reals:
+            if (v.is_number() && !v.as_number().is_integer()) {
+                as<reals_t>().push_back(v.as_number().to_double());
+                return *this;
+            }
+            break;
+        case storage::booleans:
+            if (v.is_boolean()) {
+                as<booleans_t>().push_back(v.as_boolean());
+                return *this;
+            }
+            break;
+        }
+        to_values();
+        as<values_t>().push_back(std::move(v));
+        return *this;
+    }
+
+    inline std::size_t size() const {
+        return visit([](const auto &elements) {
+            return elements.size();
+        });
+    }
+
+    inline storage get_storage() const {
+        return mode;
+    }
+
+    inline std::span<const std::int64_t> integers() const {
+        check(mode == storage::integers);
+        return as<integers_t>();
+    }
+
+    inline std::span<const double> reals() const {
+        check(mode == storage::reals);
+        return as<reals_t>();
+    }
+
+    inline const std::pmr::vector<bool> &booleans() const {
+        check(mode == storage::booleans);
+        return as<booleans_t>();
+    }
+
+    // calls f with every element as a value, typed storage stays as it is
+    template <typename function>
+    void for_each(function &&f) const {
+        visit([&f](const auto &elements) {
+            for (const auto &e : elements) {
+                if constexpr (std::is_same_v<std::remove_cvref_t<decltype(e)>, value>) {
+                    f(e);
+                } else {
+                    f(boxed(e));
+                }
+            }
+        });
     }
 
-    inline const value &get(const std::size_t index) const {
-        return values[index];
+    // An element of a const array, the value itself in values storage or a
+    // copy of a typed element, which is only a number or a boolean.
+    class element final {
+    public:
+        inline const value &operator*() const {
+            return ref ? *ref : copy;
+        }
+
+        inline const value *operator->() const {
+            return &**this;
+        }
+
+        // converts to a copy, * gives the value without copying
+        inline operator value() const {
+            return **this;
+        }
+
+        inline bool is_array() const {
+            return (**this).is_array();
+        }
+
+        inline bool is_boolean() const {
+            return (**this).is_boolean();
+        }
+
+        inline bool is_null() const {
+            return (**this).is_null();
+        }
+
+        inline bool is_number() const {
+            return (**this).is_number();
+        }
+
+        inline bool is_object() const {
+            return (**this).is_object();
+        }
+
+        inline bool is_string() const {
+            return (**this).is_string();
+        }
+
+        inline const auto &as_array() const {
+            return (**this).as_array();
+        }
+
+        inline auto as_boolean() const {
+            return (**this).as_boolean();
+        }
+
+        inline auto as_null() const {
+            return (**this).as_null();
+        }
+
+        inline auto as_number() const {
+            return (**this).as_number();
+        }
+
+        inline const auto &as_object() const {
+            return (**this).as_object();
+        }
+
+        inline const auto &as_string() const {
+            return (**this).as_string();
+        }
+
+        inline void print(std::ostream &out) const {
+            (**this).print(out);
+        }
+
+        inline void pretty_print(std::ostream &out, const std::size_t indent = 0) const {
+            (**this).pretty_print(out, indent);
+        }
+
+    private:
+        friend class array;
+
+        const value *ref = nullptr;
+        value copy = nullptr;
+
+        explicit element(const value *v): ref{v} {}
+        explicit element(value &&v): copy{std::move(v)} {}
+    };
+
+    class const_iterator final {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = element;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = element;
+
+        const_iterator() = default;
+
+        inline element operator*() const {
+            return elements->get(i);
+        }
+
+        inline const_iterator &operator++() {
+            ++i;
+            return *this;
+        }
+
+        inline const_iterator operator++(int) {
+            const_iterator result = *this;
+            ++i;
+            return result;
+        }
+
+        inline bool operator==(const const_iterator &it) const {
+            return i == it.i;
+        }
+
+    private:
+        friend class array;
+
+        const array *elements = nullptr;
+        std::size_t i = 0;
+
+        const_iterator(const array *a, const std::size_t index): elements{a}, i{index} {}
+    };
+
+    inline element get(const std::size_t index) const {
+        return visit([index](const auto &elements) {
+            if constexpr (std::is_same_v<std::remove_cvref_t<decltype(elements)>, values_t>) {
+                return element{&elements[index]};
+            } else {
+                return element{boxed(elements[index])};
+            }
+        });
     }
 
     inline value &get(const std::size_t index) {
-        return values[index];
+        to_values();
+        return as<values_t>()[index];
     }
 
-    inline auto begin() const {
-        return values.begin();
+    inline const_iterator begin() const {
+        return {this, 0};
     }
 
     inline auto begin() {
-        return values.begin();
+        to_values();
+        return as<values_t>().begin();
     }
 
-    inline auto end() const {
-        return values.end();
+    inline const_iterator end() const {
+        return {this, size()};
     }
 
     inline auto end() {
-        return values.end();
+        to_values();
+        return as<values_t>().end();
     }
 
     inline void print(std::ostream &out) const {
@@ -61,21 +314,142 @@ public:
     }
 
 private:
-    std::vector<value> values;
+    using values_t = std::pmr::vector<value>;
+    using integers_t = std::pmr::vector<std::int64_t>;
+    using reals_t = std::pmr::vector<double>;
+    using booleans_t = std::pmr::vector<bool>;
+
+    tag kind = tag::array;
+    storage mode = storage::values;
+    void *data;
+
+    template <typename type>
+    inline type &as() {
+        return *static_cast<type*>(data);
+    }
+
+    template <typename type>
+    inline const type &as() const {
+        return *static_cast<const type*>(data);
+    }
+
+    template <typename function>
+    decltype(auto) visit(function &&f) {
+        switch (mode) {
+        case storage::integers: return f(as<integers_t>());
+        case storage::reals: return f(as<reals_t>());
+        case storage::booleans: return f(as<booleans_t>());
+        default: return f(as<values_t>());
+        }
+    }
+
+    template <typename function>
+    decltype(auto) visit(function &&f) const {
+        static const values_t empty;
+        if (!data) {
+            return f(empty);
+        }
+        switch (mode) {
+        case storage::integers: return f(as<integers_t>());
+        case storage::reals: return f(as<reals_t>());
+        case storage::booleans: return f(as<booleans_t>());
+        default: return f(as<values_t>());
+        }
+    }
+
+    static inline void check(const bool b) {
+        if (!b) {
+            throw std::bad_variant_access{};
+        }
+    }
+
+    static inline value boxed(const std::int64_t l) {
+        return number{l};
+    }
+
+    static inline value boxed(const double d) {
+        return d;
+    }
+
+    static inline value boxed(const bool b) {
+        return b;
+    }
+
+    inline std::pmr::memory_resource *resource() const {
+        return visit([](const auto &elements) {
+            return elements.get_allocator().resource();
+        });
+    }
+
+    void destroy() {
+        if (data) {
+            visit([](auto &elements) {
+                std::pmr::polymorphic_allocator<>{elements.get_allocator().resource()}.delete_object(&elements);
+            });
+            data = nullptr;
+        }
+    }
+
+    // replaces the storage with an empty one of the given type
+    template <typename type>
+    type &reset(std::pmr::memory_resource *resource) {
+        type *elements = std::pmr::polymorphic_allocator<>{resource}.new_object<type>();
+        destroy();
+        data = elements;
+        return *elements;
+    }
+
+    void start(const value &v) {
+        if (v.is_boolean()) {
+            reset<booleans_t>(resource()).push_back(v.as_boolean());
+            mode = storage::booleans;
+        } else if (v.as_number().is_integer()) {
+            reset<integers_t>(resource()).push_back(v.as_number().to_long());
+            mode = storage::integers;
+        } else {
+            reset<reals_t>(resource()).push_back(v.as_number().to_double());
+            mode = storage::reals;
+        }
+    }
+
+    void to_values() {
+        if (!data) {
+            reset<values_t>(std::pmr::get_default_resource());
+            return;
+        }
+        if (mode == storage::values) {
+            return;
+        }
+        values_t *values = std::pmr::polymorphic_allocator<>{resource()}.new_object<values_t>();
+        values->reserve(size());
+        for_each([values](auto &&v) {
+            values->push_back(std::forward<decltype(v)>(v));
+        });
+        destroy();
+        data = values;
+        mode = storage::values;
+    }
+
+    inline void swap(array &a) noexcept {
+        std::swap(mode, a.mode);
+        std::swap(data, a.data);
+    }
 
     template <typename printer>
     void print(std::ostream &out, const printer p) const {
-        if (values.empty()) {
+        if (size() == 0) {
             p.print_empty_array(out);
-        } else {
-            p.print_array_opening(out);
-            p.print_value(out, values.front());
-            for (std::size_t i = 1, n = values.size(); i < n; ++i) {
+            return;
+        }
+        p.print_array_opening(out);
+        std::size_t i = 0;
+        for_each([&out, &p, &i](const value &v) {
+            if (i++ != 0) {
                 p.print_values_separator(out);
-                p.print_value(out, values[i]);
             }
-            p.print_array_closing(out);
-        }
+            p.print_value(out, v);
+        });
+        p.print_array_closing(out);
     }
 };
 
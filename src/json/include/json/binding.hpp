@@ -0,0 +1,456 @@
+#ifndef JSON_BINDING_HPP
+#define JSON_BINDING_HPP
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "escape.hpp"
+#include "exception.hpp"
+#include "extract.hpp"
+#include "parser.hpp"
+#include "serializer.hpp"
+#include "value.hpp"
+
+namespace json {
+
+// Describes the members of a struct read and written by name, list is a tuple
+// of json::field, usually specialized through JSON_FIELDS.
+template <typename type>
+struct fields;
+
+}
+
+namespace json::tmp {
+
+template <typename owner, typename member>
+struct field final {
+    using type = member;
+
+    std::string_view name;
+    member owner::*pointer;
+};
+
+template <typename type>
+concept bound = requires {
+    std::tuple_size<std::remove_cvref_t<decltype(fields<type>::list)>>::value;
+};
+
+template <typename type>
+concept optional_like = requires(type &t) {
+    t.has_value();
+    t.reset();
+    t.emplace();
+};
+
+template <typename type>
+concept sequence = requires(type &t, typename type::value_type &&e) {
+    t.push_back(std::move(e));
+    t.clear();
+};
+
+// strings keeping a copy of what is assigned to them, the views of the input
+// or of the unescaped characters the binder gives would dangle in a member
+template <typename type>
+concept owning_string = std::is_constructible_v<type, std::string> && !std::is_trivially_copyable_v<type>;
+
+template <typename type>
+inline constexpr std::size_t field_count = std::tuple_size_v<std::remove_cvref_t<decltype(fields<type>::list)>>;
+
+static constexpr std::uint64_t seeded_hash(const std::string_view s, const std::uint64_t seed) {
+    std::uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for (const char c : s) {
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+// Collision free hash of the names known at compile time, the seed is searched
+// for while compiling, at run time a name costs one hash and one comparison.
+template <std::size_t n>
+class perfect_hash final {
+public:
+    static constexpr std::size_t size = std::bit_ceil(n * 4 + 1);
+
+    constexpr perfect_hash(const std::array<std::string_view, n> &keys): names{keys} {
+        for (std::size_t a = 0; a < n; ++a) {
+            for (std::size_t b = a + 1; b < n; ++b) {
+                if (names[a] == names[b]) {
+                    throw std::invalid_argument{"json::fields names must be unique"};
+                }
+            }
+        }
+        while (!place()) {
+            ++seed;
+        }
+    }
+
+    // position of the name or n
+    constexpr std::size_t find(const std::string_view name) const {
+        const std::size_t position = slots[seeded_hash(name, seed) & (size - 1)];
+        return position < n && names[position] == name ? position : n;
+    }
+
+private:
+    std::array<std::string_view, n> names;
+    std::array<std::uint16_t, size> slots{};
+    std::uint64_t seed = 0;
+
+    constexpr bool place() {
+        slots.fill(static_cast<std::uint16_t>(n));
+        for (std::size_t i = 0; i < n; ++i) {
+            std::uint16_t &slot = slots[seeded_hash(names[i], seed) & (size - 1)];
+            if (slot != n) {
+                return false;
+            }
+            slot = static_cast<std::uint16_t>(i);
+        }
+        return true;
+    }
+};
+
+// Parses straight into the members of the types described by json::fields,
+// the decoder of every member is chosen from its type at compile time. Names
+// without a member are skipped without validation, like with json::extract,
+// and members missing from the input keep their value.
+class binder final {
+public:
+    binder(const std::string_view input): s{input} {}
+
+    template <typename type>
+    void read(type &t) {
+        i = next(i);
+        if constexpr (std::is_same_v<type, value>) {
+            t = parse(s, i);
+        } else if constexpr (std::is_same_v<type, bool>) {
+            t = s[i] == 't';
+            parse_literal(s, i, t ? "true" : "false");
+        } else if constexpr (std::is_integral_v<type>) {
+            read_integer(t);
+        } else if constexpr (std::is_floating_point_v<type>) {
+            t = static_cast<type>(parse_number(s, i).to_double());
+        } else if constexpr (optional_like<type>) {
+            if (s[i] == 'n') {
+                parse_literal(s, i, "null");
+                t.reset();
+            } else {
+                read(t.emplace());
+            }
+        } else if constexpr (std::is_assignable_v<type&, std::string_view>) {
+            static_assert(owning_string<type>, "string members must own their characters, like std::string");
+            expect(i, '"');
+            ++i;
+            t = parse_string(s, i, buffer);
+        } else if constexpr (sequence<type>) {
+            enter();
+            read_array(t);
+            --depth;
+        } else {
+            static_assert(bound<type>, "json::fields is not specialized for the type");
+            enter();
+            read_object(t);
+            --depth;
+        }
+    }
+
+    void finish() const {
+        if (const auto j = skip_spaces(s, i); j != std::string_view::npos) {
+            throw exception{s, j};
+        }
+    }
+
+private:
+    template <typename type>
+    using reader = void (*)(binder &, type &);
+
+    std::string_view s;
+    std::string_view::size_type i = 0;
+    std::string buffer;
+    std::size_t depth = 0; // containers around i, limited like for json::parse
+
+    inline void enter() {
+        if (depth == default_max_depth) {
+            throw exception{s, i};
+        }
+        ++depth;
+    }
+
+    inline std::string_view::size_type next(const std::string_view::size_type j) const {
+        const std::string_view::size_type k = skip_spaces(s, j);
+        if (k == std::string_view::npos) {
+            throw exception{s, s.size()};
+        }
+        return k;
+    }
+
+    inline void expect(const std::string_view::size_type j, const char c) const {
+        if (s[j] != c) {
+            throw exception{s, j};
+        }
+    }
+
+    template <typename type>
+    void read_integer(type &t) {
+        const std::string_view::size_type first = i + (s[i] == '-');
+        if (first + 1 < s.size() && s[first] == '0' && is_digit(s[first + 1])) {
+            throw exception{s, first + 1};
+        }
+        const char *last = s.data() + s.size();
+        const auto [p, ec] = std::from_chars(s.data() + i, last, t);
+        if (ec != std::errc{} || (p != last && (*p == '.' || *p == 'e' || *p == 'E'))) {
+            throw exception{s, i};
+        }
+        i = static_cast<std::string_view::size_type>(p - s.data());
+    }
+
+    template <typename type>
+    void read_array(type &t) {
+        expect(i, '[');
+        t.clear();
+        i = next(i + 1);
+        if (s[i] == ']') {
+            ++i;
+            return;
+        }
+        while (true) {
+            if constexpr (std::is_same_v<typename type::value_type, value>) {
+                t.push_back(parse(s, i));
+            } else {
+                typename type::value_type element{};
+                read(element);
+                t.push_back(std::move(element));
+            }
+            i = next(i);
+            if (s[i] == ']') {
+                ++i;
+                return;
+            }
+            expect(i++, ',');
+        }
+    }
+
+    template <typename type>
+    void read_object(type &t) {
+        static constexpr std::size_t n = field_count<type>;
+        static constexpr perfect_hash<n> names{field_names<type>(std::make_index_sequence<n>{})};
+        static constexpr std::array<reader<type>, n> readers = field_readers<type>(std::make_index_sequence<n>{});
+        expect(i, '{');
+        i = next(i + 1);
+        if (s[i] == '}') {
+            ++i;
+            return;
+        }
+        while (true) {
+            expect(i, '"');
+            ++i;
+            const std::size_t position = names.find(parse_string(s, i, buffer));
+            i = next(i);
+            expect(i++, ':');
+            if (position != n) {
+                readers[position](*this, t);
+            } else {
+                i = skip_value(s, next(i));
+            }
+            i = next(i);
+            if (s[i] == '}') {
+                ++i;
+                return;
+            }
+            expect(i, ',');
+            i = next(i + 1);
+        }
+    }
+
+    template <typename type, std::size_t ...indexes>
+    static constexpr std::array<std::string_view, sizeof...(indexes)> field_names(std::index_sequence<indexes...>) {
+        return {std::get<indexes>(fields<type>::list).name...};
+    }
+
+    template <typename type, std::size_t index>
+    static void read_field(binder &b, type &t) {
+        b.read(t.*std::get<index>(fields<type>::list).pointer);
+    }
+
+    template <typename type, std::size_t ...indexes>
+    static constexpr std::array<reader<type>, sizeof...(indexes)> field_readers(std::index_sequence<indexes...>) {
+        return {&read_field<type, indexes>...};
+    }
+};
+
+template <typename type>
+concept string_like = std::is_convertible_v<const type&, std::string_view>;
+
+static constexpr std::size_t escaped_size(const std::string_view s) {
+    std::size_t size = 0;
+    for (const char c : s) {
+        char e[6]{};
+        size += needs_escape(c) ? escape(c, e) : 1;
+    }
+    return size;
+}
+
+template <typename type, std::size_t index>
+inline constexpr std::string_view field_name = std::get<index>(fields<type>::list).name;
+
+template <typename type, std::size_t index>
+static constexpr std::array<char, escaped_size(field_name<type, index>) + 4> make_prefix() {
+    std::array<char, escaped_size(field_name<type, index>) + 4> prefix{};
+    std::size_t k = 0;
+    prefix[k++] = index == 0 ? '{' : ',';
+    prefix[k++] = '"';
+    for (const char c : field_name<type, index>) {
+        if (needs_escape(c)) {
+            char e[6]{};
+            for (std::size_t j = 0, n = escape(c, e); j < n; ++j) {
+                prefix[k++] = e[j];
+            }
+        } else {
+            prefix[k++] = c;
+        }
+    }
+    prefix[k++] = '"';
+    prefix[k] = ':';
+    return prefix;
+}
+
+// {"name": for the first member, ,"name": for the others, escaped at compile time
+template <typename type, std::size_t index>
+inline constexpr auto field_prefix = make_prefix<type, index>();
+
+// Writes the types described by json::fields in the compact form, the names
+// are constant fragments so only the values are formatted at run time.
+template <typename sink>
+class struct_writer final {
+public:
+    struct_writer(sink &target): out{target} {}
+
+    template <typename type>
+    void write(const type &t) {
+        if constexpr (std::is_same_v<type, value>) {
+            serializer<sink, false>{out}.write(t, 0);
+        } else if constexpr (std::is_same_v<type, bool>) {
+            t ? out.write("true", 4) : out.write("false", 5);
+        } else if constexpr (std::is_arithmetic_v<type>) {
+            char str[number::max_chars];
+            out.write(str, static_cast<std::size_t>(std::to_chars(str, str + sizeof(str), t).ptr - str));
+        } else if constexpr (optional_like<type>) {
+            if (t.has_value()) {
+                write(*t);
+            } else {
+                out.write("null", 4);
+            }
+        } else if constexpr (string_like<type>) {
+            const std::string_view s = t;
+            out.put('"');
+            write_escaped(out, s);
+            out.put('"');
+        } else if constexpr (sequence<type>) {
+            out.put('[');
+            bool first = true;
+            for (const auto &e : t) {
+                if (!first) {
+                    out.put(',');
+                }
+                first = false;
+                write(static_cast<const typename type::value_type &>(e));
+            }
+            out.put(']');
+        } else {
+            static_assert(bound<type>, "json::fields is not specialized for the type");
+            write_object(t, std::make_index_sequence<field_count<type>>{});
+        }
+    }
+
+private:
+    sink &out;
+
+    template <typename type, std::size_t ...indexes>
+    void write_object(const type &t, std::index_sequence<indexes...>) {
+        if constexpr (sizeof...(indexes) == 0) {
+            out.write("{}", 2);
+        } else {
+            (write_field<type, indexes>(t), ...);
+            out.put('}');
+        }
+    }
+
+    template <typename type, std::size_t index>
+    inline void write_field(const type &t) {
+        out.write(field_prefix<type, index>.data(), field_prefix<type, index>.size());
+        write(t.*std::get<index>(fields<type>::list).pointer);
+    }
+};
+
+}
+
+namespace json {
+
+template <typename owner, typename member>
+constexpr tmp::field<owner, member> field(const std::string_view name, member owner::*pointer) {
+    return {name, pointer};
+}
+
+// Reads s into t without building a json::value, see tmp::binder. The type is
+// a struct described by json::fields or a container of them.
+template <typename type>
+requires tmp::bound<type> || tmp::sequence<type>
+inline void parse(const std::string_view s, type &t) {
+    tmp::binder b{s};
+    b.read(t);
+    b.finish();
+}
+
+template <typename type>
+requires tmp::bound<type> || tmp::sequence<type>
+inline type parse(const std::string_view s) {
+    type t{};
+    parse(s, t);
+    return t;
+}
+
+// Appends the compact form of t to out, the names of the members come from
+// json::fields like for json::parse<type>.
+template <typename type>
+requires tmp::bound<type> || tmp::sequence<type>
+inline void serialize(const type &t, std::string &out) {
+    tmp::string_sink sink{out};
+    tmp::struct_writer<tmp::string_sink>{sink}.write(t);
+}
+
+// Same as json::serialize_to for a json::value.
+template <typename type>
+requires tmp::bound<type> || tmp::sequence<type>
+inline std::size_t serialize_to(const type &t, char *data, const std::size_t size) {
+    tmp::buffer_sink sink{data, size};
+    tmp::struct_writer<tmp::buffer_sink>{sink}.write(t);
+    return sink.size;
+}
+
+}
+
+#define JSON_FIELDS_PARENS ()
+#define JSON_FIELDS_EXPAND(...) JSON_FIELDS_EXPAND3(JSON_FIELDS_EXPAND3(JSON_FIELDS_EXPAND3(JSON_FIELDS_EXPAND3(__VA_ARGS__))))
+#define JSON_FIELDS_EXPAND3(...) JSON_FIELDS_EXPAND2(JSON_FIELDS_EXPAND2(JSON_FIELDS_EXPAND2(JSON_FIELDS_EXPAND2(__VA_ARGS__))))
+#define JSON_FIELDS_EXPAND2(...) JSON_FIELDS_EXPAND1(JSON_FIELDS_EXPAND1(JSON_FIELDS_EXPAND1(JSON_FIELDS_EXPAND1(__VA_ARGS__))))
+#define JSON_FIELDS_EXPAND1(...) __VA_ARGS__
+#define JSON_FIELDS_EACH(type, member, ...) \
+json::field(#member, &type::member) __VA_OPT__(, JSON_FIELDS_AGAIN JSON_FIELDS_PARENS (type, __VA_ARGS__))
+#define JSON_FIELDS_AGAIN() JSON_FIELDS_EACH
+
+// Describes the members of a struct for json::parse<type> and friends, the
+// JSON names are the member names. Used at global scope, up to 64 members.
+#define JSON_FIELDS(type, ...) \
+template <> \
+struct json::fields<type> { \
+    static constexpr auto list = std::make_tuple(JSON_FIELDS_EXPAND(JSON_FIELDS_EACH(type, __VA_ARGS__))); \
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <ostream>
 
+#include "tag.hpp"
+
 namespace json {
 
 class boolean final {
@@ -23,6 +25,7 @@ public:
     }
 
 private:
+    tmp::tag kind = tmp::tag::boolean;
     bool value;
 };
 
@@ -0,0 +1,18 @@
+#ifndef JSON_CPU_HPP
+#define JSON_CPU_HPP
+
+#include "utf8/cpu.hpp"
+
+#ifdef UTF8_X86
+#define JSON_X86 1
+#endif
+
+namespace json::tmp {
+
+// the SIMD kernels share the CPU detection of the UTF-8 checkers
+using utf8::cpu_has_avx2;
+using utf8::cpu_has_ssse3;
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef JSON_DOCUMENT_HPP
+#define JSON_DOCUMENT_HPP
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "exception.hpp"
+#include "index.hpp"
+#include "parser.hpp"
+#include "value.hpp"
+
+namespace json {
+
+// Tells json::document that the caller keeps the input alive as long as the document.
+struct pinned_t final {
+    explicit pinned_t() = default;
+};
+
+inline constexpr pinned_t pinned{};
+
+// Parsed value tree allocated from a single monotonic arena. The tree is never
+// destroyed node by node, the arena releases all of it at once, so the root is
+// read only: values allocated elsewhere must not be moved into it.
+//
+// When the document owns its input, or the input is pinned, strings without
+// escapes are borrowed from it instead of being copied into the arena.
+class document final {
+public:
+    document(const std::string_view s,
+             std::pmr::memory_resource *upstream = std::pmr::get_default_resource()):
+        arena{initial_size(s), upstream}, root_value{parse(s, false)} {}
+
+    document(const char *s, std::pmr::memory_resource *upstream = std::pmr::get_default_resource()):
+        document{std::string_view{s}, upstream} {}
+
+    document(const std::string_view s,
+             pinned_t,
+             std::pmr::memory_resource *upstream = std::pmr::get_default_resource()):
+        arena{initial_size(s), upstream}, root_value{parse(s, true)} {}
+
+    document(std::string &&s, std::pmr::memory_resource *upstream = std::pmr::get_default_resource()):
+        input{std::move(s)}, arena{initial_size(input), upstream}, root_value{parse(input, true)} {}
+
+    document(const document &) = delete;
+    document &operator=(const document &) = delete;
+
+    inline const value &root() const {
+        return *root_value;
+    }
+
+private:
+    std::string input;
+    std::pmr::monotonic_buffer_resource arena;
+    const value *root_value;
+
+    static std::size_t initial_size(const std::string_view s) {
+        return s.size() * 2 + 1024;
+    }
+
+    const value *parse(const std::string_view s, const bool borrow) {
+        std::pmr::polymorphic_allocator<value> allocator{&arena};
+        if (s.size() <= tmp::structural_index::max_size) {
+            const auto index = tmp::structural_index::build(s);
+            return allocator.new_object<value>(tmp::index_parser{s, index, &arena, borrow}.parse());
+        }
+        std::string_view::size_type i = 0;
+        value *result = allocator.new_object<value>(tmp::parse(s, i, &arena, borrow));
+        if (const auto j = tmp::skip_spaces(s, i); j != std::string_view::npos) {
+            throw exception{s, j};
+        }
+        return result;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef JSON_ESCAPE_HPP
+#define JSON_ESCAPE_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+#include "cpu.hpp"
+
+namespace json::tmp {
+
+// quotes, backslashes and control characters can't appear raw inside a string
+static constexpr bool needs_escape(const char c) {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+// The finders return the index of the first character of [p, p + n) needing
+// an escape, or n, the wide ones leave the tail to the narrower ones.
+struct scalar_escape_finder final {
+    static std::size_t find(const char *p, const std::size_t n) {
+        std::size_t i = 0;
+        for (; i < n && !needs_escape(p[i]); ++i) {
+        }
+        return i;
+    }
+};
+
+#ifdef __SSE2__
+struct sse2_escape_finder final {
+    static std::size_t find(const char *p, const std::size_t n) {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            const __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, control), v)
+            );
+            if (const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(special))) {
+                return i + static_cast<std::size_t>(std::countr_zero(mask));
+            }
+        }
+        return i + scalar_escape_finder::find(p + i, n - i);
+    }
+};
+
+using default_escape_finder = sse2_escape_finder;
+#else
+using default_escape_finder = scalar_escape_finder;
+#endif
+
+#ifdef JSON_X86
+// compiled for AVX2 whatever the flags, only used when the CPU has it
+struct avx2_escape_finder final {
+    [[gnu::target("avx2")]] static std::size_t find(const char *p, const std::size_t n) {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control = _mm256_set1_epi8(0x1F);
+        std::size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            const __m256i special = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v)
+            );
+            if (const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(special))) {
+                return i + static_cast<std::size_t>(std::countr_zero(mask));
+            }
+        }
+        return i + default_escape_finder::find(p + i, n - i);
+    }
+};
+#endif
+
+// Returns the index of the first character of [p, p + n) needing an escape, or
+// n, with the AVX2 finder when the CPU has it, else default_escape_finder.
+static inline std::size_t find_escape(const char *p, const std::size_t n) {
+#ifdef JSON_X86
+    if (cpu_has_avx2()) {
+        return avx2_escape_finder::find(p, n);
+    }
+#endif
+    return default_escape_finder::find(p, n);
+}
+
+// Writes into e the escape sequence of a character needing one, returns its size.
+static constexpr std::size_t escape(const char c, char *e) {
+    constexpr const char *hex = "0123456789abcdef";
+    e[0] = '\\';
+    switch (c) {
+    case '"': e[1] = '"'; return 2;
+    case '\\': e[1] = '\\'; return 2;
+    case '\b': e[1] = 'b'; return 2;
+    case '\f': e[1] = 'f'; return 2;
+    case '\n': e[1] = 'n'; return 2;
+    case '\r': e[1] = 'r'; return 2;
+    case '\t': e[1] = 't'; return 2;
+    default:
+        e[1] = 'u';
+        e[2] = '0';
+        e[3] = '0';
+        e[4] = hex[static_cast<unsigned char>(c) >> 4];
+        e[5] = hex[static_cast<unsigned char>(c) & 0xF];
+        return 6;
+    }
+}
+
+// Writes s with the escapes required by JSON, out is anything with
+// write(const char*, size) like std::ostream or the serializer sinks.
+// Runs without anything to escape are written with a single call.
+template <typename output>
+void write_escaped(output &out, const std::string_view s) {
+    const char *p = s.data();
+    for (std::size_t n = s.size(); n != 0;) {
+        const std::size_t k = find_escape(p, n);
+        out.write(p, k);
+        if (k == n) {
+            break;
+        }
+        char e[6];
+        out.write(e, escape(p[k], e));
+        p += k + 1;
+        n -= k + 1;
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef JSON_EXTRACT_HPP
+#define JSON_EXTRACT_HPP
+
+#include <charconv>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "exception.hpp"
+#include "parser.hpp"
+#include "value.hpp"
+
+namespace json::tmp {
+
+// splits a JSON pointer (RFC 6901) into its unescaped reference tokens
+static std::vector<std::string> split_pointer(const std::string_view p) {
+    std::vector<std::string> tokens;
+    if (p.empty()) {
+        return tokens;
+    }
+    if (p[0] != '/') {
+        throw exception{p, 0};
+    }
+    tokens.emplace_back();
+    for (std::string_view::size_type i = 1, n = p.size(); i < n; ++i) {
+        if (p[i] == '/') {
+            tokens.emplace_back();
+        } else if (p[i] != '~') {
+            tokens.back().push_back(p[i]);
+        } else if (i + 1 < n && (p[i + 1] == '0' || p[i + 1] == '1')) {
+            tokens.back().push_back(p[++i] == '0' ? '~' : '/');
+        } else {
+            throw exception{p, i};
+        }
+    }
+    return tokens;
+}
+
+// i points right after the opening quote, returns the index of the closing one
+static std::string_view::size_type skip_string(const std::string_view s, std::string_view::size_type i) {
+    const char *data = s.data();
+    for (const std::string_view::size_type n = s.size(); i < n; ++i) {
+        const void *quote = std::memchr(data + i, '"', n - i);
+        if (!quote) {
+            break;
+        }
+        i = static_cast<std::string_view::size_type>(static_cast<const char*>(quote) - data);
+        std::string_view::size_type backslashes = 0;
+        for (std::string_view::size_type j = i; j > 0 && data[j - 1] == '\\'; --j) {
+            ++backslashes;
+        }
+        if (backslashes % 2 == 0) {
+            return i;
+        }
+    }
+    throw exception{s, s.size()};
+}
+
+// Skips the value starting at i matching brackets and quotes only, nothing is
+// validated, returns the index right after the value.
+static std::string_view::size_type skip_value(const std::string_view s, std::string_view::size_type i) {
+    std::size_t depth = 0;
+    for (const std::string_view::size_type n = s.size(); i < n; ++i) {
+        switch (s[i]) {
+        case '"':
+            i = skip_string(s, i + 1);
+            if (depth == 0) {
+                return i + 1;
+            }
+            break;
+        case '[':
+        case '{':
+            ++depth;
+            break;
+        case ']':
+        case '}':
+            if (depth == 0) {
+                return i;
+            }
+            if (--depth == 0) {
+                return i + 1;
+            }
+            break;
+        default:
+            if (depth == 0 && (s[i] == ',' || is_space(s[i]))) {
+                return i;
+            }
+        }
+    }
+    if (depth != 0) {
+        throw exception{s, s.size()};
+    }
+    return s.size();
+}
+
+// Walks the document descending only into the subtrees leading to one of the
+// requested paths, the values found are materialized with tmp::parse.
+class extractor final {
+public:
+    extractor(const std::string_view input,
+              const std::vector<std::vector<std::string>> &tokens,
+              std::vector<std::optional<value>> &values):
+        s{input}, paths{tokens}, results{values}, left{tokens.size()} {}
+
+    void extract() {
+        std::vector<std::size_t> candidates(paths.size());
+        for (std::size_t c = 0; c < candidates.size(); ++c) {
+            candidates[c] = c;
+        }
+        std::string_view::size_type i = 0;
+        walk(i, 0, candidates);
+    }
+
+private:
+    std::string_view s;
+    const std::vector<std::vector<std::string>> &paths;
+    std::vector<std::optional<value>> &results;
+    std::size_t left;
+    std::string buffer;
+
+    inline std::string_view::size_type next(const std::string_view::size_type i) const {
+        const std::string_view::size_type j = skip_spaces(s, i);
+        if (j == std::string_view::npos) {
+            throw exception{s, s.size()};
+        }
+        return j;
+    }
+
+    inline void expect(const std::string_view::size_type i, const char c) const {
+        if (s[i] != c) {
+            throw exception{s, i};
+        }
+    }
+
+    // candidates of the next level whose token at depth equals name
+    std::vector<std::size_t> filter(const std::vector<std::size_t> &candidates,
+                                    const std::size_t depth,
+                                    const std::string_view name) const
+    {
+        std::vector<std::size_t> result;
+        for (const std::size_t c : candidates) {
+            if (paths[c].size() > depth && paths[c][depth] == name) {
+                result.push_back(c);
+            }
+        }
+        return result;
+    }
+
+    // returns true once all the paths are found
+    bool walk(std::string_view::size_type &i, const std::size_t depth, const std::vector<std::size_t> &candidates) {
+        i = next(i);
+        bool deeper = false;
+        std::optional<std::string_view::size_type> end;
+        for (const std::size_t c : candidates) {
+            if (paths[c].size() > depth) {
+                deeper = true;
+            } else if (!results[c]) {
+                std::string_view::size_type j = i;
+                results[c] = parse(s, j);
+                end = j;
+                if (--left == 0) {
+                    return true;
+                }
+            }
+        }
+        if (!deeper) {
+            i = end ? *end : skip_value(s, i);
+            return false;
+        }
+        switch (get_type(s[i])) {
+        case type::array:
+            return walk_array(i, depth, candidates);
+        case type::object:
+            return walk_object(i, depth, candidates);
+        default:
+            i = skip_value(s, i);
+            return false;
+        }
+    }
+
+    bool walk_array(std::string_view::size_type &i, const std::size_t depth, const std::vector<std::size_t> &candidates) {
+        i = next(i + 1);
+        if (s[i] == ']') {
+            ++i;
+            return false;
+        }
+        for (std::size_t index = 0;; ++index) {
+            char digits[24];
+            const auto [last, ec] = std::to_chars(digits, digits + sizeof(digits), index);
+            const std::vector<std::size_t> matched = filter(candidates, depth, {digits, static_cast<std::size_t>(last - digits)});
+            if (matched.empty()) {
+                i = skip_value(s, next(i));
+            } else if (walk(i, depth + 1, matched)) {
+                return true;
+            }
+            i = next(i);
+            if (s[i] == ']') {
+                ++i;
+                return false;
+            }
+            expect(i++, ',');
+        }
+    }
+
+    bool walk_object(std::string_view::size_type &i, const std::size_t depth, const std::vector<std::size_t> &candidates) {
+        i = next(i + 1);
+        if (s[i] == '}') {
+            ++i;
+            return false;
+        }
+        while (true) {
+            expect(i, '"');
+            ++i;
+            const std::vector<std::size_t> matched = filter(candidates, depth, parse_string(s, i, buffer));
+            i = next(i);
+            expect(i++, ':');
+            if (matched.empty()) {
+                i = skip_value(s, next(i));
+            } else if (walk(i, depth + 1, matched)) {
+                return true;
+            }
+            i = next(i);
+            if (s[i] == '}') {
+                ++i;
+                return false;
+            }
+            expect(i, ',');
+            i = next(i + 1);
+        }
+    }
+};
+
+}
+
+namespace json {
+
+// Returns the values at the given JSON pointers in the same order, or nullopt
+// for the ones missing in s. Subtrees not leading to a requested path are
+// skipped without validation and the scan stops once every path is found.
+inline std::vector<std::optional<value>> extract(const std::string_view s,
+                                                 const std::vector<std::string_view> &pointers)
+{
+    std::vector<std::vector<std::string>> tokens;
+    tokens.reserve(pointers.size());
+    for (const std::string_view p : pointers) {
+        tokens.push_back(tmp::split_pointer(p));
+    }
+    std::vector<std::optional<value>> result(pointers.size());
+    if (!pointers.empty()) {
+        tmp::extractor{s, tokens, result}.extract();
+    }
+    return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef JSON_INCREMENTAL_HPP
+#define JSON_INCREMENTAL_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "escape.hpp"
+#include "exception.hpp"
+#include "parser.hpp"
+
+namespace json {
+
+// Push parser accepting the document in arbitrary chunks, it reports the same
+// events as sax_parse and keeps its state between feed calls, so only the
+// token crossing a chunk boundary is buffered.
+template <typename handler>
+class incremental_parser final {
+public:
+    incremental_parser(handler &target): h{target} {}
+
+    void feed(const std::string_view chunk) {
+        begin = 0;
+        for (std::string_view::size_type j = 0, n = chunk.size(); j < n;) {
+            j = step(chunk, j);
+        }
+        if (st == state::string || st == state::number) {
+            buffer.append(chunk.data() + begin, chunk.size() - begin);
+            buffered = true;
+        }
+    }
+
+    // must be called after the last chunk, throws if the document is incomplete
+    void finish() {
+        if (st == state::number) {
+            begin = 0;
+            end_number(std::string_view{}, 0);
+        }
+        if (st != state::done) {
+            throw exception{std::string_view{}, 0};
+        }
+    }
+
+private:
+    enum class state: std::uint8_t {
+        value,
+        first_value,
+        key,
+        first_key,
+        colon,
+        comma,
+        string,
+        escape,
+        unicode,
+        low_backslash,
+        low_u,
+        number,
+        literal,
+        done
+    };
+
+    handler &h;
+    state st = state::value;
+    std::vector<bool> stack; // true for objects
+    std::string buffer;
+    bool buffered = false;
+    bool is_key = false;
+    std::string_view::size_type begin = 0;
+    std::string_view literal;
+    std::size_t literal_pos = 0;
+    std::uint32_t code = 0;
+    std::uint32_t high = 0;
+    int digits = 0;
+
+    static constexpr bool is_number_char(const char c) {
+        return tmp::is_digit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    std::string_view::size_type step(const std::string_view s, std::string_view::size_type j) {
+        const char c = s[j];
+        switch (st) {
+        case state::value:
+        case state::first_value:
+            if (tmp::is_space(c)) {
+                return j + 1;
+            }
+            if (c == ']' && st == state::first_value) {
+                stack.pop_back();
+                h.on_array_end();
+                end_value();
+                return j + 1;
+            }
+            return start_value(s, j);
+        case state::key:
+        case state::first_key:
+            if (tmp::is_space(c)) {
+                return j + 1;
+            }
+            if (c == '}' && st == state::first_key) {
+                stack.pop_back();
+                h.on_object_end();
+                end_value();
+                return j + 1;
+            }
+            if (c != '"') {
+                throw exception{s, j};
+            }
+            start_string(j + 1, true);
+            return j + 1;
+        case state::colon:
+            if (tmp::is_space(c)) {
+                return j + 1;
+            }
+            if (c != ':') {
+                throw exception{s, j};
+            }
+            st = state::value;
+            return j + 1;
+        case state::comma:
+            if (tmp::is_space(c)) {
+                return j + 1;
+            }
+            if (c == ',') {
+                st = stack.back() ? state::key : state::value;
+                return j + 1;
+            }
+            if (c == (stack.back() ? '}' : ']')) {
+                const bool in_object = stack.back();
+                stack.pop_back();
+                if (in_object) {
+                    h.on_object_end();
+                } else {
+                    h.on_array_end();
+                }
+                end_value();
+                return j + 1;
+            }
+            throw exception{s, j};
+        case state::string:
+            return step_string(s, j);
+        case state::escape:
+            return step_escape(s, j);
+        case state::unicode:
+            return step_unicode(s, j);
+        case state::low_backslash:
+        case state::low_u:
+            if (c != (st == state::low_backslash ? '\\' : 'u')) {
+                throw exception{s, j};
+            }
+            st = st == state::low_backslash ? state::low_u : state::unicode;
+            return j + 1;
+        case state::number:
+            if (is_number_char(c)) {
+                return j + 1;
+            }
+            end_number(s, j);
+            return j;
+        case state::literal:
+            if (c != literal[literal_pos]) {
+                throw exception{s, j};
+            }
+            if (++literal_pos == literal.size()) {
+                if (literal[0] == 'n') {
+                    h.on_null();
+                } else {
+                    h.on_bool(literal[0] == 't');
+                }
+                end_value();
+            }
+            return j + 1;
+        case state::done:
+            if (!tmp::is_space(c)) {
+                throw exception{s, j};
+            }
+            return j + 1;
+        }
+        return j + 1;
+    }
+
+    std::string_view::size_type start_value(const std::string_view s, const std::string_view::size_type j) {
+        switch (tmp::get_type(s[j])) {
+        case tmp::type::array:
+            stack.push_back(false);
+            h.on_array_begin();
+            st = state::first_value;
+            break;
+        case tmp::type::object:
+            stack.push_back(true);
+            h.on_object_begin();
+            st = state::first_key;
+            break;
+        case tmp::type::string:
+            start_string(j + 1, false);
+            break;
+        case tmp::type::number:
+            begin = j;
+            buffer.clear();
+            buffered = false;
+            st = state::number;
+            return j + 1;
+        case tmp::type::boolean:
+        case tmp::type::null:
+            literal = s[j] == 't' ? "true" : (s[j] == 'f' ? "false" : "null");
+            literal_pos = 1;
+            st = state::literal;
+            break;
+        default:
+            throw exception{s, j};
+        }
+        return j + 1;
+    }
+
+    void end_value() {
+        st = stack.empty() ? state::done : state::comma;
+    }
+
+    void start_string(const std::string_view::size_type j, const bool key) {
+        begin = j;
+        buffer.clear();
+        buffered = false;
+        is_key = key;
+        st = state::string;
+    }
+
+    std::string_view::size_type step_string(const std::string_view s, std::string_view::size_type j) {
+        for (const std::string_view::size_type n = s.size(); j < n; ++j) {
+            j += tmp::find_escape(s.data() + j, n - j);
+            if (j == n) {
+                break;
+            }
+            const char c = s[j];
+            if (c == '"') {
+                std::string_view str;
+                if (buffered) {
+                    buffer.append(s.data() + begin, j - begin);
+                    str = buffer;
+                } else {
+                    str = s.substr(begin, j - begin);
+                }
+                if (const std::size_t bad = utf8::find_invalid(str.data(), str.size()); bad != str.size()) {
+                    throw exception{s, buffered ? j : begin + bad};
+                }
+                if (is_key) {
+                    h.on_key(str);
+                    st = state::colon;
+                } else {
+                    h.on_string(str);
+                    end_value();
+                }
+                return j + 1;
+            }
+            if (c == '\\') {
+                buffer.append(s.data() + begin, j - begin);
+                buffered = true;
+                st = state::escape;
+                return j + 1;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                throw exception{s, j};
+            }
+        }
+        return j;
+    }
+
+    std::string_view::size_type step_escape(const std::string_view s, const std::string_view::size_type j) {
+        if (s[j] == 'u') {
+            code = 0;
+            digits = 0;
+            st = state::unicode;
+            return j + 1;
+        }
+        tmp::parse_escape(s, j, buffer);
+        begin = j + 1;
+        st = state::string;
+        return j + 1;
+    }
+
+    std::string_view::size_type step_unicode(const std::string_view s, const std::string_view::size_type j) {
+        const int d = tmp::hex_digit(s[j]);
+        if (d < 0) {
+            throw exception{s, j};
+        }
+        code = (code << 4) | static_cast<std::uint32_t>(d);
+        if (++digits < 4) {
+            return j + 1;
+        }
+        if (high) {
+            if (code < 0xDC00 || code > 0xDFFF) {
+                throw exception{s, j};
+            }
+            code = 0x10000 + ((high - 0xD800) << 10) + (code - 0xDC00);
+            high = 0;
+        } else if (code >= 0xD800 && code <= 0xDBFF) {
+            high = code;
+            code = 0;
+            digits = 0;
+            st = state::low_backslash;
+            return j + 1;
+        } else if (code >= 0xDC00 && code <= 0xDFFF) {
+            throw exception{s, j};
+        }
+        tmp::append_utf8(buffer, code);
+        begin = j + 1;
+        st = state::string;
+        return j + 1;
+    }
+
+    void end_number(const std::string_view s, const std::string_view::size_type j) {
+        std::string_view str;
+        if (buffered) {
+            buffer.append(s.data() + begin, j - begin);
+            str = buffer;
+        } else {
+            str = s.substr(begin, j - begin);
+        }
+        std::string_view::size_type i = 0;
+        const number n = tmp::parse_number(str, i);
+        if (i != str.size()) {
+            throw exception{str, i};
+        }
+        h.on_number(n);
+        end_value();
+    }
+};
+
+}
+
+#endif
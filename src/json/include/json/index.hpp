@@ -0,0 +1,325 @@
+#ifndef JSON_INDEX_HPP
+#define JSON_INDEX_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+#include "cpu.hpp"
+#include "parallel.hpp"
+
+namespace json::tmp {
+
+struct block_masks final {
+    std::uint64_t quote = 0;
+    std::uint64_t backslash = 0;
+    std::uint64_t op = 0;
+    std::uint64_t space = 0;
+};
+
+struct scalar_classifier final {
+    static constexpr std::size_t block_size = 64;
+
+    static block_masks classify(const char *p) {
+        block_masks m;
+        for (std::size_t i = 0; i < block_size; ++i) {
+            const std::uint8_t c = classes[static_cast<unsigned char>(p[i])];
+            const std::uint64_t bit = std::uint64_t{1} << i;
+            m.quote |= (c & quote) ? bit : 0;
+            m.backslash |= (c & backslash) ? bit : 0;
+            m.op |= (c & op) ? bit : 0;
+            m.space |= (c & space) ? bit : 0;
+        }
+        return m;
+    }
+
+private:
+    static constexpr std::uint8_t quote = 1;
+    static constexpr std::uint8_t backslash = 2;
+    static constexpr std::uint8_t op = 4;
+    static constexpr std::uint8_t space = 8;
+
+    static constexpr std::array<std::uint8_t, 256> classes = [] {
+        std::array<std::uint8_t, 256> table{};
+        table[static_cast<unsigned char>('"')] = quote;
+        table[static_cast<unsigned char>('\\')] = backslash;
+        for (const char c : {'{', '}', '[', ']', ':', ','}) {
+            table[static_cast<unsigned char>(c)] = op;
+        }
+        for (const char c : {' ', '\t', '\n', '\r'}) {
+            table[static_cast<unsigned char>(c)] = space;
+        }
+        return table;
+    }();
+};
+
+#ifdef __SSE2__
+struct sse2_classifier final {
+    static constexpr std::size_t block_size = 64;
+
+    static block_masks classify(const char *p) {
+        block_masks m;
+        for (std::size_t i = 0; i < block_size; i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            m.quote |= mask(eq(v, '"')) << i;
+            m.backslash |= mask(eq(v, '\\')) << i;
+            m.op |= mask(_mm_or_si128(
+                _mm_or_si128(_mm_or_si128(eq(v, '{'), eq(v, '}')), _mm_or_si128(eq(v, '['), eq(v, ']'))),
+                _mm_or_si128(eq(v, ':'), eq(v, ','))
+            )) << i;
+            m.space |= mask(_mm_or_si128(
+                _mm_or_si128(eq(v, ' '), eq(v, '\t')), _mm_or_si128(eq(v, '\n'), eq(v, '\r'))
+            )) << i;
+        }
+        return m;
+    }
+
+private:
+    static inline __m128i eq(const __m128i v, const char c) {
+        return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+    }
+
+    static inline std::uint64_t mask(const __m128i v) {
+        return static_cast<std::uint16_t>(_mm_movemask_epi8(v));
+    }
+};
+#endif
+
+#ifdef JSON_X86
+// compiled for AVX2 whatever the flags, only used when the CPU has it
+struct avx2_classifier final {
+    static constexpr std::size_t block_size = 64;
+
+    [[gnu::target("avx2")]] static block_masks classify(const char *p) {
+        block_masks m;
+        for (std::size_t i = 0; i < block_size; i += 32) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            m.quote |= mask(eq(v, '"')) << i;
+            m.backslash |= mask(eq(v, '\\')) << i;
+            m.op |= mask(_mm256_or_si256(
+                _mm256_or_si256(_mm256_or_si256(eq(v, '{'), eq(v, '}')), _mm256_or_si256(eq(v, '['), eq(v, ']'))),
+                _mm256_or_si256(eq(v, ':'), eq(v, ','))
+            )) << i;
+            m.space |= mask(_mm256_or_si256(
+                _mm256_or_si256(eq(v, ' '), eq(v, '\t')), _mm256_or_si256(eq(v, '\n'), eq(v, '\r'))
+            )) << i;
+        }
+        return m;
+    }
+
+private:
+    [[gnu::target("avx2")]] static inline __m256i eq(const __m256i v, const char c) {
+        return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+    }
+
+    [[gnu::target("avx2")]] static inline std::uint64_t mask(const __m256i v) {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+    }
+};
+#endif
+
+#if defined(__SSE2__)
+using default_classifier = sse2_classifier;
+#else
+using default_classifier = scalar_classifier;
+#endif
+
+// Stage 1: finds structural characters outside of strings, unescaped quotes and
+// the first character of every scalar, 64 bytes at a time.
+class structural_index final {
+public:
+    using position_t = std::uint32_t;
+
+    static constexpr std::size_t max_size = std::numeric_limits<position_t>::max();
+
+    // uses the AVX2 classifier when the CPU has it, else default_classifier
+    static structural_index build(const std::string_view s) {
+#ifdef JSON_X86
+        if (cpu_has_avx2()) {
+            return build<avx2_classifier>(s);
+        }
+#endif
+        return build<default_classifier>(s);
+    }
+
+    static structural_index build(const std::string_view s, const unsigned threads, const std::size_t chunk_size) {
+#ifdef JSON_X86
+        if (cpu_has_avx2()) {
+            return build<avx2_classifier>(s, threads, chunk_size);
+        }
+#endif
+        return build<default_classifier>(s, threads, chunk_size);
+    }
+
+    template <typename classifier>
+    static structural_index build(const std::string_view s) {
+        structural_index result;
+        result.values.reserve(s.size() / 4 + 1);
+        result.unclosed_string = build<classifier>(s, 0, s.size(), false, result.values);
+        return result;
+    }
+
+    // Same positions as build, the input is cut into chunks of about
+    // chunk_size bytes right after operators or spaces, so no escape or
+    // scalar continues across a cut. Chunks are indexed on threads as if they
+    // started outside of strings, then the ones the quote parities of the
+    // chunks before them put inside a string are indexed again.
+    template <typename classifier>
+    static structural_index build(const std::string_view s, const unsigned threads, const std::size_t chunk_size) {
+        const std::size_t n = s.size();
+        std::vector<std::size_t> cuts = {0};
+        while (cuts.back() < n) {
+            std::size_t cut = std::min(cuts.back() + std::max<std::size_t>(chunk_size, 1), n);
+            for (; cut < n && !is_cut(s[cut - 1]); ++cut) {
+            }
+            cuts.push_back(cut);
+        }
+        struct chunk final {
+            std::vector<position_t> values;
+            bool ends_inside = false;
+        };
+        std::vector<chunk> chunks(cuts.size() - 1);
+        run_parallel(chunks.size(), threads, [&](const std::size_t k) {
+            chunks[k].values.reserve((cuts[k + 1] - cuts[k]) / 4 + 1);
+            chunks[k].ends_inside = build<classifier>(s, cuts[k], cuts[k + 1], false, chunks[k].values);
+        });
+        std::vector<std::size_t> mispredicted;
+        bool inside = false;
+        std::size_t size = 0;
+        for (std::size_t k = 0; k < chunks.size(); ++k) {
+            if (inside) {
+                mispredicted.push_back(k);
+            }
+            inside ^= chunks[k].ends_inside;
+            size += chunks[k].values.size();
+        }
+        run_parallel(mispredicted.size(), threads, [&](const std::size_t m) {
+            const std::size_t k = mispredicted[m];
+            chunks[k].values.clear();
+            build<classifier>(s, cuts[k], cuts[k + 1], true, chunks[k].values);
+        });
+        structural_index result;
+        result.values.reserve(size);
+        for (const chunk &c : chunks) {
+            result.values.insert(result.values.end(), c.values.begin(), c.values.end());
+        }
+        result.unclosed_string = inside;
+        return result;
+    }
+
+    inline auto size() const {
+        return values.size();
+    }
+
+    inline position_t operator[](const std::size_t i) const {
+        return values[i];
+    }
+
+    inline const std::vector<position_t> &positions() const {
+        return values;
+    }
+
+    inline bool has_unclosed_string() const {
+        return unclosed_string;
+    }
+
+private:
+    std::vector<position_t> values;
+    bool unclosed_string = false;
+
+    static constexpr bool is_cut(const char c) {
+        switch (c) {
+        case '{': case '}': case '[': case ']': case ':': case ',':
+        case ' ': case '\t': case '\n': case '\r':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // indexes [begin, end) and returns whether it ends inside a string
+    template <typename classifier>
+    static bool build(const std::string_view s,
+                      const std::size_t begin,
+                      const std::size_t end,
+                      const bool inside,
+                      std::vector<position_t> &out)
+    {
+        state st;
+        st.in_string = inside ? ~std::uint64_t{0} : 0;
+        std::size_t i = begin;
+        for (; i + classifier::block_size <= end; i += classifier::block_size) {
+            st.process(classifier::classify(s.data() + i), i, out);
+        }
+        if (i < end) {
+            char tail[classifier::block_size];
+            std::memset(tail, ' ', classifier::block_size);
+            std::memcpy(tail, s.data() + i, end - i);
+            st.process(classifier::classify(tail), i, out);
+        }
+        return st.in_string != 0;
+    }
+
+    struct state final {
+        std::uint64_t escaped = 0;   // bit 0 is set when the previous block ends with an escaping backslash
+        std::uint64_t in_string = 0; // all ones when the previous block ends inside a string
+        std::uint64_t scalar = 0;    // bit 0 is set when the previous block ends with a scalar character
+
+        void process(const block_masks &m, const std::size_t base, std::vector<position_t> &out) {
+            const std::uint64_t esc = find_escaped(m.backslash);
+            const std::uint64_t quotes = m.quote & ~esc;
+            const std::uint64_t inside = prefix_xor(quotes) ^ in_string;
+            in_string = static_cast<std::uint64_t>(static_cast<std::int64_t>(inside) >> 63);
+
+            const std::uint64_t scalars = ~(m.op | m.space | quotes | inside);
+            const std::uint64_t scalar_starts = scalars & ~((scalars << 1) | scalar);
+            scalar = scalars >> 63;
+
+            flatten((m.op & ~inside) | quotes | scalar_starts, base, out);
+        }
+
+        std::uint64_t find_escaped(std::uint64_t backslash) {
+            std::uint64_t result = escaped;
+            backslash &= ~result;
+            escaped = 0;
+            while (backslash) {
+                const std::uint64_t bit = backslash & (~backslash + 1);
+                if (bit == (std::uint64_t{1} << 63)) {
+                    escaped = 1;
+                }
+                result |= bit << 1;
+                backslash &= ~(bit | (bit << 1));
+            }
+            return result;
+        }
+
+        static std::uint64_t prefix_xor(std::uint64_t x) {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            x ^= x << 16;
+            x ^= x << 32;
+            return x;
+        }
+
+        static void flatten(std::uint64_t bits, const std::size_t base, std::vector<position_t> &out) {
+            while (bits) {
+                out.push_back(static_cast<position_t>(base + std::countr_zero(bits)));
+                bits &= bits - 1;
+            }
+        }
+    };
+};
+
+}
+
+#endif
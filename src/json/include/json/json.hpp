@@ -1,7 +1,17 @@
 #ifndef JSON_HPP
 #define JSON_HPP
 
+#include "binding.hpp"
+#include "document.hpp"
+#include "extract.hpp"
+#include "incremental.hpp"
+#include "lines.hpp"
 #include "parser.hpp"
+#include "query.hpp"
+#include "sax.hpp"
+#include "serializer.hpp"
+#include "tape.hpp"
+#include "validate.hpp"
 #include "value.hpp"
 
 #endif
@@ -0,0 +1,54 @@
+#ifndef JSON_KEY_HPP
+#define JSON_KEY_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace json {
+
+// Object member name with its hash computed once, reusable for any number of
+// lookups. It only refers to the characters, which must outlive it.
+class key final {
+public:
+    key(const char *s): key{std::string_view{s}} {}
+    key(const std::string_view s): name{s}, hash{std::hash<std::string_view>{}(s)} {}
+
+    constexpr std::string_view get_name() const {
+        return name;
+    }
+
+    constexpr std::size_t get_hash() const {
+        return hash;
+    }
+
+    friend constexpr bool operator==(const key &k, const std::string_view s) {
+        return k.name == s;
+    }
+
+private:
+    std::string_view name;
+    std::size_t hash;
+};
+
+}
+
+namespace json::tmp {
+
+// Transparent hash of object member names, a json::key brings its own.
+struct key_hash final {
+    using is_transparent = void;
+
+    inline std::size_t operator()(const std::string_view s) const {
+        return std::hash<std::string_view>{}(s);
+    }
+
+    inline std::size_t operator()(const key &k) const {
+        return k.get_hash();
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef JSON_LINES_HPP
+#define JSON_LINES_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+#include "parser.hpp"
+#include "value.hpp"
+
+namespace json::tmp {
+
+// Parses the lines of a JSON lines input on worker threads. The input is cut
+// into batches of about batch_size bytes at line ends, workers take the next
+// batch and the calling thread delivers the parsed batches in input order,
+// at most window batches are parsed ahead of the one being delivered.
+// Strings can't hold a raw line feed, so cutting at line feeds never splits
+// a valid record, however long.
+class line_parser final {
+public:
+    static constexpr std::size_t default_batch_size = 1 << 20;
+
+    line_parser(const std::string_view input, const unsigned threads, const std::size_t batch_size = default_batch_size):
+        s{input}, workers{thread_count(threads)}
+    {
+        for (std::size_t begin = 0, n = s.size(); begin < n;) {
+            std::size_t end = std::min(begin + batch_size, n);
+            if (const void *lf = end < n ? std::memchr(s.data() + end, '\n', n - end) : nullptr) {
+                end = static_cast<std::size_t>(static_cast<const char*>(lf) - s.data()) + 1;
+            } else {
+                end = n;
+            }
+            batches.push_back({s.substr(begin, end - begin), {}, {}, false});
+            begin = end;
+        }
+        window = workers * 4;
+    }
+
+    line_parser(const line_parser &) = delete;
+    line_parser &operator=(const line_parser &) = delete;
+
+    ~line_parser() {
+        stop();
+    }
+
+    // calls f with every value in input order and rethrows the first error
+    // after delivering the values preceding it
+    template <typename function>
+    void run(function &&f) {
+        if (workers == 1 || batches.size() <= 1) {
+            for (batch &b : batches) {
+                parse_batch(b);
+                deliver(b, f);
+            }
+            return;
+        }
+        const std::size_t count = std::min(workers, batches.size());
+        pool.reserve(count);
+        for (std::size_t t = 0; t < count; ++t) {
+            pool.emplace_back([this] {
+                work();
+            });
+        }
+        for (std::size_t k = 0; k < batches.size(); ++k) {
+            {
+                std::unique_lock lock{mutex};
+                changed.wait(lock, [this, k] {
+                    return batches[k].done;
+                });
+            }
+            deliver(batches[k], f);
+            {
+                std::lock_guard lock{mutex};
+                delivered = k + 1;
+            }
+            changed.notify_all();
+        }
+        stop();
+    }
+
+private:
+    struct batch final {
+        std::string_view lines;
+        std::vector<value> values;
+        std::exception_ptr error;
+        bool done;
+    };
+
+    std::string_view s;
+    std::size_t workers;
+    std::size_t window = 0;
+    std::vector<batch> batches;
+    std::vector<std::thread> pool;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t next = 0;
+    std::size_t delivered = 0;
+    bool stopping = false;
+
+    // the records of a batch share one builder, and so the shapes of their objects
+    static void parse_batch(batch &b) {
+        try {
+            const std::string_view lines = b.lines;
+            builder values;
+            for (std::size_t begin = 0, n = lines.size(); begin < n;) {
+                const void *lf = std::memchr(lines.data() + begin, '\n', n - begin);
+                const std::size_t end = lf ? static_cast<std::size_t>(static_cast<const char*>(lf) - lines.data()) : n;
+                const std::string_view line = lines.substr(begin, end - begin);
+                if (std::string_view::size_type i = skip_spaces(line, 0); i != std::string_view::npos) {
+                    reader<builder>{line, values}.parse(i);
+                    if (i = skip_spaces(line, i); i != std::string_view::npos) {
+                        throw exception{line, i};
+                    }
+                    b.values.push_back(values.get());
+                }
+                begin = end + 1;
+            }
+        } catch (...) {
+            b.error = std::current_exception();
+        }
+        b.done = true;
+    }
+
+    template <typename function>
+    static void deliver(batch &b, function &f) {
+        std::vector<value> values = std::move(b.values);
+        for (value &v : values) {
+            f(std::move(v));
+        }
+        if (b.error) {
+            std::rethrow_exception(b.error);
+        }
+    }
+
+    void work() {
+        while (true) {
+            std::size_t k;
+            {
+                std::unique_lock lock{mutex};
+                changed.wait(lock, [this] {
+                    return stopping || next == batches.size() || next < delivered + window;
+                });
+                if (stopping || next == batches.size()) {
+                    return;
+                }
+                k = next++;
+            }
+            batch b{batches[k].lines, {}, {}, false};
+            parse_batch(b);
+            {
+                std::lock_guard lock{mutex};
+                batches[k] = std::move(b);
+            }
+            changed.notify_all();
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        changed.notify_all();
+        for (std::thread &t : pool) {
+            t.join();
+        }
+        pool.clear();
+    }
+};
+
+}
+
+namespace json {
+
+// Parses the JSON lines (NDJSON) in s on threads worker threads, all the cores
+// for 0, and calls f(value&&) for every record in input order on the calling
+// thread. Blank lines are skipped, a malformed line throws its json::exception
+// once the records before it are delivered.
+template <typename function>
+void parse_lines(const std::string_view s, function &&f, const unsigned threads = 0) {
+    tmp::line_parser{s, threads}.run(f);
+}
+
+// Same as above reading in from its current position, block_size bytes at a
+// time, a line longer than a block makes the block grow until its end.
+template <typename function>
+void parse_lines(std::istream &in, function &&f, const unsigned threads = 0, const std::size_t block_size = 1 << 26) {
+    std::string block;
+    std::size_t size = 0;
+    while (in) {
+        block.resize(std::max(block.size(), size + block_size));
+        in.read(block.data() + size, static_cast<std::streamsize>(block.size() - size));
+        size += static_cast<std::size_t>(in.gcount());
+        std::size_t end = size;
+        if (in) {
+            const std::size_t lf = std::string_view{block.data(), size}.rfind('\n');
+            if (lf == std::string_view::npos) {
+                continue;
+            }
+            end = lf + 1;
+        }
+        tmp::line_parser{{block.data(), end}, threads}.run(f);
+        block.erase(0, end);
+        size -= end;
+    }
+}
+
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <ostream>
 
+#include "tag.hpp"
+
 namespace json {
 
 struct null final {
@@ -15,6 +17,9 @@ struct null final {
     inline void pretty_print(std::ostream &out, const std::size_t = 0) const {
         print(out);
     }
+
+private:
+    tmp::tag kind = tmp::tag::null;
 };
 
 }
@@ -2,30 +2,49 @@
 #define JSON_NUMBER_HPP
 
 #include <charconv>
+#include <cstddef>
 #include <cstdint>
-#include <iomanip>
-#include <limits>
 #include <ostream>
-#include <variant>
+#include <stdexcept>
+
+#include "tag.hpp"
 
 namespace json {
 
 class number final {
 public:
-    constexpr number(int i): value{static_cast<std::int64_t>(i)} {}
-    constexpr number(std::int64_t l): value{l} {}
-    constexpr number(double d): value{d} {}
+    static constexpr std::size_t max_chars = 32;
+
+    constexpr number(int i): kind{tmp::tag::integer}, long_value{i} {}
+    constexpr number(std::int64_t l): kind{tmp::tag::integer}, long_value{l} {}
+    constexpr number(double d): kind{tmp::tag::real}, double_value{d} {}
+
+    constexpr bool is_integer() const {
+        return kind == tmp::tag::integer;
+    }
 
     constexpr std::int64_t to_long() const {
-        return std::visit(long_getter{}, value);
+        return is_integer() ? long_value : static_cast<std::int64_t>(double_value);
     }
 
     constexpr double to_double() const {
-        return std::visit(double_getter{}, value);
+        return is_integer() ? static_cast<double>(long_value) : double_value;
+    }
+
+    // Writes into [first, last) and returns the end of the written characters,
+    // doubles get the shortest form parsing back to the same value.
+    inline char *to_chars(char *first, char *last) const {
+        const auto [p, ec] = is_integer() ? std::to_chars(first, last, long_value)
+                                          : std::to_chars(first, last, double_value);
+        if (ec != std::errc{}) {
+            throw std::length_error{"json::number buffer is too small"};
+        }
+        return p;
     }
 
     inline void print(std::ostream &out) const {
-        std::visit(printer{out}, value);
+        char str[max_chars];
+        out.write(str, to_chars(str, str + max_chars) - str);
     }
 
     inline void pretty_print(std::ostream &out, const std::size_t = 0) const {
@@ -33,45 +52,10 @@ public:
     }
 
 private:
-    std::variant<std::int64_t, double> value;
-
-    struct long_getter {
-        constexpr std::int64_t operator()(std::int64_t value) const {
-            return value;
-        }
-
-        constexpr std::int64_t operator()(double value) const {
-            return static_cast<std::int64_t>(value);
-        }
-    };
-
-    struct double_getter {
-        constexpr double operator()(std::int64_t value) const {
-            return static_cast<double>(value);
-        }
-
-        constexpr double operator()(double value) const {
-            return value;
-        }
-    };
-
-    struct printer {
-        std::ostream &out;
-
-        static constexpr int max_long_digits = std::numeric_limits<std::int64_t>::digits10 + 2;
-        static constexpr int max_precision = std::numeric_limits<double>::digits10;
-
-        void operator()(std::int64_t value) const {
-            char str[max_long_digits];
-            auto [p, ec] = std::to_chars(str, str + max_long_digits, value);
-            if (ec == std::errc{}) {
-                out.write(str, p - str);
-            }
-        }
-
-        void operator()(double value) const {
-            out << std::setprecision(max_precision) << value;
-        }
+    tmp::tag kind;
+    union {
+        std::int64_t long_value;
+        double double_value;
     };
 };
 
@@ -1,34 +1,62 @@
 #ifndef JSON_OBJECT_HPP
 #define JSON_OBJECT_HPP
 
+#include <memory_resource>
 #include <ostream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "key.hpp"
+#include "shape.hpp"
+#include "tag.hpp"
 #include "utils.hpp"
 
 namespace json::tmp {
 
+// Values are kept in insertion order, their names live in a tmp::shape which
+// objects with the same names in the same order may share.
 template <typename value>
 class object final {
+    template <typename element>
+    class iterator_t;
+
 public:
-    object(): pairs{new pairs_t{}} {}
+    using iterator = iterator_t<value>;
+    using const_iterator = iterator_t<const value>;
+
+    object(): object{std::pmr::get_default_resource()} {}
+
+    object(std::pmr::memory_resource *resource):
+        pairs{std::pmr::polymorphic_allocator<>{resource}.new_object<pairs_t>()} {}
 
+    // shares the shape when it comes from the same memory resource
     object(const object &o): object{} {
-        *pairs = *o.pairs;
+        pairs->values = o.pairs->values;
+        if (shape *keys = o.pairs->keys; keys && keys->resource() == pairs->values.get_allocator().resource()) {
+            shape::acquire(keys);
+            pairs->keys = keys;
+        } else if (keys) {
+            pairs->keys = shape::create(pairs->values.get_allocator().resource(), keys);
+        }
     }
 
-    object(object &&o): pairs{std::exchange(o.pairs, nullptr)} {}
+    object(object &&o) noexcept: pairs{std::exchange(o.pairs, nullptr)} {}
 
     template <typename ...types>
+    requires (!(sizeof...(types) == 1 && (std::is_same_v<std::remove_cvref_t<types>, object> && ...)))
     object(types &&...args): object{} {
-        pairs->reserve(sizeof...(types) >> 1);
+        pairs->values.reserve(sizeof...(types) >> 1);
         add(std::forward<types>(args)...);
     }
 
     ~object() {
-        delete pairs;
+        if (pairs) {
+            shape::release(pairs->keys);
+            std::pmr::polymorphic_allocator<>{pairs->values.get_allocator().resource()}.delete_object(pairs);
+        }
     }
 
     object &operator=(const object &o) {
@@ -37,49 +65,89 @@ public:
         return *this;
     }
 
-    object &operator=(object &&o) {
+    object &operator=(object &&o) noexcept {
         object tmp{std::move(o)};
         std::swap(pairs, tmp.pairs);
         return *this;
     }
 
     inline auto size() const {
-        return pairs->size();
+        return pairs->values.size();
     }
 
-    inline const value *get(const std::string name) const {
-        auto it = pairs->find(name);
-        return it != pairs->end() ? &it->second : nullptr;
+    inline const value *get(const std::string_view name) const {
+        return find(name, name);
     }
 
-    inline value *get(const std::string name) {
-        auto it = pairs->find(name);
-        return it != pairs->end() ? &it->second : nullptr;
+    inline value *get(const std::string_view name) {
+        return find(name, name);
     }
 
-    inline auto begin() const {
-        return pairs->begin();
+    // skips hashing the name, convenient for names looked up again and again
+    inline const value *get(const key &k) const {
+        return find(k.get_name(), k);
     }
 
-    inline auto begin() {
-        return pairs->begin();
+    inline value *get(const key &k) {
+        return find(k.get_name(), k);
     }
 
-    inline auto end() const {
-        return pairs->end();
+    inline const value *get(const char *name) const {
+        return get(std::string_view{name});
     }
 
-    inline auto end() {
-        return pairs->end();
+    inline value *get(const char *name) {
+        return get(std::string_view{name});
     }
 
-    inline object &put(std::string name, const value &&v) {
-        pairs->insert_or_assign(std::move(name), v);
+    // true when both objects have the same names in the same order through one
+    // shared shape, their values can then be accessed by position
+    inline bool same_shape(const object &o) const {
+        return pairs->keys == o.pairs->keys;
+    }
+
+    inline const_iterator begin() const {
+        return {pairs->keys, pairs->values.data(), 0};
+    }
+
+    inline iterator begin() {
+        return {pairs->keys, pairs->values.data(), 0};
+    }
+
+    inline const_iterator end() const {
+        return {pairs->keys, pairs->values.data(), pairs->values.size()};
+    }
+
+    inline iterator end() {
+        return {pairs->keys, pairs->values.data(), pairs->values.size()};
+    }
+
+    inline object &put(const std::string_view name, const value &&v) {
+        value copy = v;
+        assign(name, std::move(copy));
         return *this;
     }
 
-    inline object &put(std::string name, value &&v) {
-        pairs->insert_or_assign(std::move(name), std::move(v));
+    inline object &put(const std::string_view name, value &&v) {
+        assign(name, std::move(v));
+        return *this;
+    }
+
+    // same as put, but new names follow the transitions of shapes, so the
+    // objects built with the same names in the same order share one shape
+    // as long as they have no more than shape_table::max_size names
+    inline object &put(shape_table &shapes, const std::string_view name, value &&v) {
+        if (pairs->keys && pairs->keys->size() >= shape_table::max_size) {
+            assign(name, std::move(v));
+        } else if (value *existing = find(name, name)) {
+            *existing = std::move(v);
+        } else {
+            shape *next = shapes.transition(pairs->keys, name);
+            shape::acquire(next);
+            shape::release(pairs->keys);
+            pairs->keys = next;
+            pairs->values.push_back(std::move(v));
+        }
         return *this;
     }
 
@@ -92,30 +160,83 @@ public:
     }
 
 private:
-    using pairs_t = std::unordered_map<std::string, value>;
+    struct pairs_t final {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+
+        pairs_t(const allocator_type &allocator): values{allocator} {}
+
+        shape *keys = nullptr;
+        std::pmr::vector<value> values;
+    };
+
+    template <typename element>
+    class iterator_t final {
+    public:
+        iterator_t(const shape *k, element *v, const std::size_t i): keys{k}, values{v}, index{i} {}
+
+        inline std::pair<const shape::name_t &, element &> operator*() const {
+            return {keys->name(index), values[index]};
+        }
+
+        inline iterator_t &operator++() {
+            ++index;
+            return *this;
+        }
+
+        inline bool operator==(const iterator_t &it) const {
+            return index == it.index;
+        }
+
+    private:
+        const shape *keys;
+        element *values;
+        std::size_t index;
+    };
+
+    tag kind = tag::object;
     pairs_t *pairs;
 
     template <typename name, typename val, typename ...types>
     void add(name &&n, val &&v, types &&...args) {
-        pairs->insert_or_assign(std::forward<name>(n), std::forward<val>(v));
+        assign(std::string_view{n}, value{std::forward<val>(v)});
         add(std::forward<types>(args)...);
     }
 
     void add() {
     }
 
+    template <typename hashed>
+    value *find(const std::string_view name, const hashed &h) const {
+        const std::size_t position = pairs->keys ? pairs->keys->find(name, h) : shape::npos;
+        return position != shape::npos ? &pairs->values[position] : nullptr;
+    }
+
+    void assign(const std::string_view name, value &&v) {
+        if (value *existing = find(name, name)) {
+            *existing = std::move(v);
+            return;
+        }
+        std::pmr::memory_resource *resource = pairs->values.get_allocator().resource();
+        if (!pairs->keys || pairs->keys->is_shared() || pairs->keys->resource() != resource) {
+            shape *keys = shape::create(resource, pairs->keys);
+            shape::release(pairs->keys);
+            pairs->keys = keys;
+        }
+        pairs->keys->add(name);
+        pairs->values.push_back(std::move(v));
+    }
+
     template <typename printer>
     void print(std::ostream &out, const printer p) const {
-        if (pairs->empty()) {
+        const auto &values = pairs->values;
+        if (values.empty()) {
             p.print_empty_object(out);
         } else {
-            auto it = pairs->begin();
             p.print_object_opening(out);
-            p.print_key_value(out, it->first, it->second);
-            ++it;
-            for (auto end = pairs->end(); it != end; ++it) {
+            p.print_key_value(out, pairs->keys->name(0), values[0]);
+            for (std::size_t i = 1, n = values.size(); i < n; ++i) {
                 p.print_values_separator(out);
-                p.print_key_value(out, it->first, it->second);
+                p.print_key_value(out, pairs->keys->name(i), values[i]);
             }
             p.print_object_closing(out);
         }
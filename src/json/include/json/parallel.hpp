@@ -0,0 +1,59 @@
+#ifndef JSON_PARALLEL_HPP
+#define JSON_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace json::tmp {
+
+static inline unsigned thread_count(const unsigned threads) {
+    return threads ? threads : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// Calls f(k) for every k in [0, count) on up to threads threads, the calling
+// thread included, and rethrows the first exception once all of them stop.
+template <typename function>
+void run_parallel(const std::size_t count, const unsigned threads, function &&f) {
+    std::atomic<std::size_t> next = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    const auto work = [&] {
+        for (std::size_t k; (k = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            try {
+                f(k);
+            } catch (...) {
+                std::lock_guard lock{mutex};
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next.store(count, std::memory_order_relaxed);
+            }
+        }
+    };
+    const std::size_t n = std::min<std::size_t>(thread_count(threads), count);
+    std::vector<std::thread> pool;
+    pool.reserve(n);
+    // when a thread can't be started the ones running do its share
+    try {
+        for (std::size_t t = 1; t < n; ++t) {
+            pool.emplace_back(work);
+        }
+    } catch (...) {
+    }
+    work();
+    for (std::thread &t : pool) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}
+
+#endif
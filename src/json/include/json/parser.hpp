@@ -1,14 +1,22 @@
 #ifndef JSON_PARSER_HPP
 #define JSON_PARSER_HPP
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <string>
 #include <string_view>
+#include <vector>
 
+#include "escape.hpp"
 #include "exception.hpp"
+#include "index.hpp"
+#include "parallel.hpp"
+#include "utf8.hpp"
 #include "value.hpp"
 
-
-#include <iostream>
-
 namespace json::tmp {
 
 enum class type: std::uint8_t {
@@ -69,242 +77,798 @@ static constexpr type get_type(const char c) {
     }
 }
 
-static std::string_view::size_type parse(const std::string_view s,
-                                         const std::string_view::size_type i);
-
-static std::string_view::size_type parse_array(const std::string_view s,
-                                               const std::string_view::size_type i)
+static constexpr bool match(const std::string_view s,
+                            const std::string_view::size_type i,
+                            const std::string_view literal)
 {
-    std::cout << "array" << std::endl;
-    const std::string_view::size_type n = s.size();
-    std::string_view::size_type j = skip_spaces(s, i);
-    if (j < n && s[j] == ']') {
-        return j + 1;
+    return i <= s.size() && s.substr(i, literal.size()) == literal;
+}
+
+static constexpr int hex_digit(const char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
     }
-    while (j < n) {
-        j = parse(s, j);
-        j = skip_spaces(s, j);
-        if (j < n) {
-            const char c = s[j];
-            if (c == ']') {
-                return j + 1;
-            }
-            if (c == ',') {
-                ++j;
-                continue;
-            }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static std::uint32_t parse_hex4(const std::string_view s, const std::string_view::size_type i) {
+    if (i + 4 > s.size()) {
+        throw exception{s, i};
+    }
+    std::uint32_t code = 0;
+    for (std::string_view::size_type j = i; j < i + 4; ++j) {
+        const int d = hex_digit(s[j]);
+        if (d < 0) {
+            throw exception{s, j};
         }
-        break;
+        code = (code << 4) | static_cast<std::uint32_t>(d);
+    }
+    return code;
+}
+
+static void append_utf8(std::string &out, const std::uint32_t code) {
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
     }
-    throw exception{s, i};
 }
 
-static std::string_view::size_type parse_boolean(const std::string_view s,
-                                                 const std::string_view::size_type i)
+// i points right after the backslash, returns the index after the escape sequence
+static std::string_view::size_type parse_escape(const std::string_view s,
+                                                const std::string_view::size_type i,
+                                                std::string &out)
 {
-    std::cout << "boolean" << std::endl;
+    if (i >= s.size()) {
+        throw exception{s, i};
+    }
     switch (s[i]) {
-    case 'r':
-        if ((i + 2) < s.size() && s[i + 1] == 'u' && s[i + 2] == 'e') {
-            return i + 3;
+    case '"': out.push_back('"'); return i + 1;
+    case '\\': out.push_back('\\'); return i + 1;
+    case '/': out.push_back('/'); return i + 1;
+    case 'b': out.push_back('\b'); return i + 1;
+    case 'f': out.push_back('\f'); return i + 1;
+    case 'n': out.push_back('\n'); return i + 1;
+    case 'r': out.push_back('\r'); return i + 1;
+    case 't': out.push_back('\t'); return i + 1;
+    case 'u': break;
+    default: throw exception{s, i};
+    }
+    std::uint32_t code = parse_hex4(s, i + 1);
+    std::string_view::size_type j = i + 5;
+    if (code >= 0xD800 && code <= 0xDBFF) {
+        if (!match(s, j, "\\u")) {
+            throw exception{s, j};
         }
-        break;
-    case 'a':
-        if ((i + 2) < s.size() && s[i + 1] == 'l' && s[i + 2] == 's' && s[i + 3] == 'e') {
-            return i + 4;
+        const std::uint32_t low = parse_hex4(s, j + 2);
+        if (low < 0xDC00 || low > 0xDFFF) {
+            throw exception{s, j};
         }
-        break;
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        j += 6;
+    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+        throw exception{s, i};
     }
-    throw exception{s, i};
+    append_utf8(out, code);
+    return j;
 }
 
-static std::string_view::size_type parse_null(const std::string_view s,
-                                              const std::string_view::size_type i)
+// Escapes are ASCII and decode to valid UTF-8, so checking the raw characters
+// of a string checks its value.
+static inline void check_utf8(const std::string_view s,
+                              const std::string_view::size_type begin,
+                              const std::string_view::size_type end)
 {
-    std::cout << "null" << std::endl;
-    if ((i + 2) < s.size() && s[i] == 'u' && s[i + 1] == 'l' && s[i + 2] == 'l') {
-        return i + 3;
+    if (const std::size_t bad = utf8::find_invalid(s.data() + begin, end - begin); bad != end - begin) {
+        throw exception{s, begin + bad};
     }
-    throw exception{s, i};
 }
 
-static std::string_view::size_type parse_digits(const std::string_view s,
-                                                const std::string_view::size_type i)
+// returns a view into s when the string has no escapes, otherwise decodes it into buffer
+static std::string_view parse_string(const std::string_view s,
+                                     std::string_view::size_type &i,
+                                     std::string &buffer)
 {
-    std::cout << "digits" << std::endl;
-    bool digit = false;
-    std::string_view::size_type j = i;
-    for (std::string_view::size_type n = s.size(); j < n; ++j) {
+    const std::string_view::size_type begin = i;
+    std::string_view::size_type from = i;
+    bool escaped = false;
+    for (std::string_view::size_type j = i, n = s.size(); j < n;) {
+        j += find_escape(s.data() + j, n - j);
+        if (j == n) {
+            break;
+        }
         const char c = s[j];
-        if (is_digit(c)) {
-            digit = true;
-        } else if (digit) {
-            std::cout << "    " << s.substr(i, j - i) << std::endl;
-            return j;
+        if (c == '"') {
+            check_utf8(s, begin, j);
+            i = j + 1;
+            if (!escaped) {
+                return s.substr(begin, j - begin);
+            }
+            buffer.append(s.data() + from, j - from);
+            return buffer;
+        }
+        if (c == '\\') {
+            if (!escaped) {
+                buffer.clear();
+                escaped = true;
+            }
+            buffer.append(s.data() + from, j - from);
+            j = from = parse_escape(s, j + 1, buffer);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            throw exception{s, j};
         } else {
-            throw exception(s, j);
+            ++j;
         }
     }
-    std::cout << "    " << s.substr(i, j - i) << std::endl;
-    return j;
+    throw exception{s, begin};
 }
 
-static std::string_view::size_type parse_exponent(const std::string_view s,
-                                                  const std::string_view::size_type i)
+// decodes the content of a string whose closing quote position is already known
+static std::string_view parse_string(const std::string_view s,
+                                     const std::string_view::size_type begin,
+                                     const std::string_view::size_type end,
+                                     std::string &buffer)
 {
-    std::cout << "exponent" << std::endl;
-    bool sign = false;
-    std::string_view::size_type j = i;
-    for (std::string_view::size_type n = s.size(); j < n; ++j) {
+    std::string_view::size_type from = begin;
+    bool escaped = false;
+    for (std::string_view::size_type j = begin; j < end;) {
+        j += find_escape(s.data() + j, end - j);
+        if (j == end) {
+            break;
+        }
         const char c = s[j];
-        if (is_digit(c)) {
-            return parse_digits(s, j);
-        } else if (c == '-' || c == '+') {
-            if (sign) {
-                throw exception(s, j);
+        if (c == '\\') {
+            if (!escaped) {
+                buffer.clear();
+                escaped = true;
             }
-            sign = true;
+            buffer.append(s.data() + from, j - from);
+            j = from = parse_escape(s, j + 1, buffer);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            throw exception{s, j};
         } else {
-            throw exception(s, j);
+            ++j;
         }
     }
-    throw exception(s, i);
+    check_utf8(s, begin, end);
+    if (!escaped) {
+        return s.substr(begin, end - begin);
+    }
+    buffer.append(s.data() + from, end - from);
+    return buffer;
 }
 
-static std::string_view::size_type parse_number(const std::string_view s,
-                                                const std::string_view::size_type i)
+// whether part points into the characters of whole, parse_string results
+// that don't were unescaped into the buffer
+static inline bool is_inside(const std::string_view whole, const std::string_view part) {
+    return !whole.empty() && part.data() >= whole.data() && part.data() + part.size() <= whole.data() + whole.size();
+}
+
+// powers of ten exactly representable as double
+static constexpr double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Accumulates the significant digits of a number, more than max_digits of
+// them don't fit into the mantissa and mark it as truncated.
+struct decimal final {
+    static constexpr int max_digits = 19;
+
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+
+    inline void add(const char c, const bool fraction) {
+        const unsigned d = static_cast<unsigned>(c - '0');
+        if (digits == 0 && d == 0) {
+            exponent -= fraction;
+        } else if (digits < max_digits) {
+            mantissa = mantissa * 10 + d;
+            ++digits;
+            exponent -= fraction;
+        } else {
+            truncated |= d != 0;
+            exponent += !fraction;
+        }
+    }
+};
+
+static std::string_view::size_type parse_digits(const std::string_view s,
+                                                const std::string_view::size_type i,
+                                                decimal &value,
+                                                const bool fraction)
 {
-    std::cout << "number" << std::endl;
+    std::string_view::size_type j = i;
+    for (const std::string_view::size_type n = s.size(); j < n && is_digit(s[j]); ++j) {
+        value.add(s[j], fraction);
+    }
+    if (j == i) {
+        throw exception{s, i};
+    }
+    return j;
+}
+
+// Integers fitting into int64 are built while scanning, doubles use Clinger's
+// fast path when both the mantissa and the power of ten are exact, otherwise
+// std::from_chars does the correctly rounded conversion. Numbers too small
+// for a double become zeros of their sign, too large ones throw, which
+// json::validate agrees with.
+static number parse_number(const std::string_view s, std::string_view::size_type &i) {
     const std::string_view::size_type n = s.size();
+    const std::string_view::size_type begin = i;
     std::string_view::size_type j = i;
-    bool neg = false;
-    bool digit = false;
-    bool dot = false;
-    while (j < n) {
-        const char c = s[j];
-        switch (c) {
-        case '-':
-            if (neg || digit) {
-                throw exception(s, j);
-            }
-            neg = true;
+    decimal value;
+    bool integral = true;
+    const bool negative = j < n && s[j] == '-';
+    if (negative) {
+        ++j;
+    }
+    if (j < n && s[j] == '0') {
+        ++j;
+    } else {
+        j = parse_digits(s, j, value, false);
+    }
+    if (j < n && s[j] == '.') {
+        integral = false;
+        j = parse_digits(s, j + 1, value, true);
+    }
+    if (j < n && (s[j] == 'e' || s[j] == 'E')) {
+        integral = false;
+        ++j;
+        const bool negative_exponent = j < n && s[j] == '-';
+        if (j < n && (s[j] == '-' || s[j] == '+')) {
             ++j;
-            break;
-        case '.':
-            if (!digit || dot) {
-                throw exception(s, j);
-            }
-            dot = true;
-            j = parse_digits(s, j + 1);
-            break;
-        case 'e':
-        case 'E':
-            j = parse_exponent(s, j + 1);
-            break;
-        default:
-            if (is_digit(c)) {
-                digit = true;
-                j = parse_digits(s, j);
-            } else {
-                return j;
-            }
         }
+        const std::string_view::size_type first = j;
+        int e = 0;
+        for (; j < n && is_digit(s[j]); ++j) {
+            e = e < 100000 ? e * 10 + (s[j] - '0') : e;
+        }
+        if (j == first) {
+            throw exception{s, j};
+        }
+        value.exponent += negative_exponent ? -e : e;
     }
-    return j;
+    i = j;
+
+    if (!value.truncated) {
+        constexpr std::uint64_t max = std::numeric_limits<std::int64_t>::max();
+        if (integral && value.exponent == 0 && value.mantissa <= max + negative) {
+            return number{negative ? static_cast<std::int64_t>(0 - value.mantissa) : static_cast<std::int64_t>(value.mantissa)};
+        }
+        constexpr std::uint64_t max_exact = std::uint64_t{1} << std::numeric_limits<double>::digits;
+        if (value.mantissa <= max_exact && value.exponent >= -22 && value.exponent <= 22) {
+            double d = static_cast<double>(value.mantissa);
+            d = value.exponent < 0 ? d / exact_powers_of_ten[-value.exponent] : d * exact_powers_of_ten[value.exponent];
+            return number{negative ? -d : d};
+        }
+    }
+    double d = 0;
+    const char *last = s.data() + j;
+    const auto [p, ec] = std::from_chars(s.data() + begin, last, d);
+    if (ec == std::errc::result_out_of_range && value.digits + value.exponent <= 0) {
+        return number{negative ? -0.0 : 0.0};
+    }
+    if (ec != std::errc{} || p != last) {
+        throw exception{s, begin};
+    }
+    return number{d};
 }
 
-static std::string_view::size_type parse_string(const std::string_view s,
-                                                const std::string_view::size_type i)
+static void parse_literal(const std::string_view s,
+                          std::string_view::size_type &i,
+                          const std::string_view literal)
 {
-    std::cout << "string" << std::endl;
-    bool skip = false;
-    for (std::string_view::size_type j = i, n = s.size(); j < n; ++j) {
-        switch (s[j]) {
-        case '\\':
-            skip = !skip;
-            break;
-        case '"':
-            if (!skip) {
-                std::cout << "    " << s.substr(i, j - i) << std::endl;
-                return j + 1;
+    if (!match(s, i, literal)) {
+        throw exception{s, i};
+    }
+    i += literal.size();
+}
+
+static constexpr std::size_t default_max_depth = 1024;
+
+// containers deeper than this grow the stacks of the parsers past their first allocation
+static constexpr std::size_t reserved_depth = 64;
+
+// Single pass grammar reporting every token to the handler, see
+// json::sax_handler for the set of callbacks. The open containers are kept on
+// an explicit stack instead of the call stack, so nesting deeper than
+// max_depth throws a json::exception instead of overflowing.
+template <typename handler>
+class reader final {
+public:
+    reader(const std::string_view input, handler &target, const std::size_t max_depth = default_max_depth):
+        s{input}, h{target}, limit{max_depth}
+    {
+        stack.reserve(std::min(limit, reserved_depth));
+    }
+
+    void parse(std::string_view::size_type &i) {
+        const std::string_view::size_type n = s.size();
+        std::string_view::size_type j = i;
+        stack.clear();
+        while (true) {
+            // j is before a value
+            j = skip_spaces(s, j);
+            if (j >= n) {
+                throw exception{s, i};
+            }
+            switch (get_type(s[j])) {
+            case type::array:
+                open(']', j);
+                h.on_array_begin();
+                if (j = skip_spaces(s, j + 1); j < n && s[j] == ']') {
+                    close(j);
+                    break;
+                }
+                continue;
+            case type::boolean: {
+                const bool b = s[j] == 't';
+                parse_literal(s, j, b ? "true" : "false");
+                h.on_bool(b);
+                break;
+            }
+            case type::null:
+                parse_literal(s, j, "null");
+                h.on_null();
+                break;
+            case type::number:
+                h.on_number(parse_number(s, j));
+                break;
+            case type::object:
+                open('}', j);
+                h.on_object_begin();
+                if (j = skip_spaces(s, j + 1); j < n && s[j] == '}') {
+                    close(j);
+                    break;
+                }
+                j = parse_key(j);
+                continue;
+            case type::string:
+                ++j;
+                h.on_string(parse_string(s, j, buffer));
+                break;
+            default:
+                throw exception{s, j};
+            }
+            // j is after a value, which may close containers
+            while (true) {
+                if (stack.empty()) {
+                    i = j;
+                    return;
+                }
+                j = skip_spaces(s, j);
+                if (j >= n) {
+                    throw exception{s, i};
+                }
+                if (s[j] == stack.back()) {
+                    close(j);
+                } else if (s[j] == ',') {
+                    j = stack.back() == '}' ? parse_key(j + 1) : j + 1;
+                    break;
+                } else {
+                    throw exception{s, j};
+                }
             }
-            skip = false;
-            break;
-        default:
-            skip = false;
-            break;
         }
     }
-    throw exception{s, i};
-}
 
-static std::string_view::size_type parse_object(const std::string_view s,
-                                                const std::string_view::size_type i)
-{
-    std::cout << "object" << std::endl;
-    const std::string_view::size_type n = s.size();
-    std::string_view::size_type j = skip_spaces(s, i);
-    if (j < n && s[j] == '}') {
-        return j + 1;
+private:
+    std::string_view s;
+    handler &h;
+    std::size_t limit;
+    std::vector<char> stack; // closing characters of the open containers
+    std::string buffer;
+
+    inline void open(const char closing, const std::string_view::size_type j) {
+        if (stack.size() == limit) {
+            throw exception{s, j};
+        }
+        stack.push_back(closing);
     }
-    while (j < n) {
-        if (s[j] != '"') {
-            break;
+
+    inline void close(std::string_view::size_type &j) {
+        if (stack.back() == ']') {
+            h.on_array_end();
+        } else {
+            h.on_object_end();
         }
-        j = parse_string(s, j + 1);
+        stack.pop_back();
+        ++j;
+    }
+
+    // "name": from j, returns the index after the colon
+    std::string_view::size_type parse_key(std::string_view::size_type j) {
         j = skip_spaces(s, j);
-        if (j >= n || s[j] != ':') {
-            break;
+        if (j >= s.size() || s[j] != '"') {
+            throw exception{s, std::min(j, s.size())};
         }
-        j = parse(s, j + 1);
+        ++j;
+        h.on_key(parse_string(s, j, buffer));
         j = skip_spaces(s, j);
-        if (j < n) {
-            const char c = s[j];
-            if (c == '}') {
-                return j + 1;
-            }
-            if (c == ',') {
-                j = skip_spaces(s, j + 1);
+        if (j >= s.size() || s[j] != ':') {
+            throw exception{s, std::min(j, s.size())};
+        }
+        return j + 1;
+    }
+};
+
+// Handler assembling the value tree from reader events.
+class builder final {
+public:
+    // strings found unescaped in input are borrowed instead of copied
+    builder(std::pmr::memory_resource *allocator = std::pmr::get_default_resource(),
+            const std::string_view input = {}):
+        resource{allocator}, borrowed{input} {}
+
+    inline void on_null() {
+        add(null{});
+    }
+
+    inline void on_bool(const bool b) {
+        add(b);
+    }
+
+    inline void on_number(const number n) {
+        add(n);
+    }
+
+    inline void on_string(const std::string_view str) {
+        add(is_inside(borrowed, str) ? string::borrow(valid_utf8, str) : string{valid_utf8, str, resource});
+    }
+
+    inline void on_key(const std::string_view key) {
+        keys.emplace_back(key);
+    }
+
+    inline void on_array_begin() {
+        stack.emplace_back(value::array{resource});
+    }
+
+    inline void on_array_end() {
+        pop();
+    }
+
+    inline void on_object_begin() {
+        stack.emplace_back(value::object{resource});
+    }
+
+    inline void on_object_end() {
+        pop();
+    }
+
+    inline value get() {
+        return std::move(result);
+    }
+
+private:
+    std::pmr::memory_resource *resource;
+    std::string_view borrowed;
+    shape_table shapes{resource};
+    std::vector<value> stack;
+    std::vector<std::string> keys;
+    value result = null{};
+
+    void add(value &&v) {
+        if (stack.empty()) {
+            result = std::move(v);
+        } else if (value &top = stack.back(); top.is_array()) {
+            top.as_array().add(std::move(v));
+        } else {
+            top.as_object().put(shapes, keys.back(), std::move(v));
+            keys.pop_back();
+        }
+    }
+
+    void pop() {
+        value v = std::move(stack.back());
+        stack.pop_back();
+        add(std::move(v));
+    }
+};
+
+static value parse(const std::string_view s,
+                   std::string_view::size_type &i,
+                   std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+                   const bool borrow = false,
+                   const std::size_t max_depth = default_max_depth)
+{
+    builder b{resource, borrow ? s : std::string_view{}};
+    reader<builder>{s, b, max_depth}.parse(i);
+    return b.get();
+}
+
+// Stage 2: builds the value tree walking the positions found by structural_index.
+// The containers being filled are kept on an explicit stack, nesting deeper
+// than max_depth throws a json::exception.
+class index_parser final {
+public:
+    index_parser(const std::string_view input,
+                 const structural_index &index,
+                 std::pmr::memory_resource *allocator = std::pmr::get_default_resource(),
+                 const bool borrow_strings = false,
+                 const std::size_t max_depth = default_max_depth):
+        s{input}, positions{index.positions()}, k{0}, resource{allocator}, borrow{borrow_strings}, limit{max_depth}
+    {
+        frames.reserve(std::min(limit, reserved_depth));
+    }
+
+    value parse() {
+        value result = parse_value();
+        if (k < positions.size()) {
+            throw exception{s, positions[k]};
+        }
+        return result;
+    }
+
+    // parses the value at positions[from], which must be followed by positions[to]
+    value parse(const std::size_t from, const std::size_t to) {
+        k = from;
+        value result = parse_value();
+        if (k != to) {
+            throw exception{s, k < positions.size() ? positions[k] : s.size()};
+        }
+        return result;
+    }
+
+private:
+    // a container being filled and the name of its member being parsed
+    struct frame final {
+        value container;
+        std::string_view name;
+        std::string unescaped; // the name instead when it had escapes
+    };
+
+    std::string_view s;
+    const std::vector<structural_index::position_t> &positions;
+    std::size_t k;
+    std::pmr::memory_resource *resource;
+    bool borrow;
+    std::size_t limit;
+    shape_table shapes{resource};
+    std::string buffer;
+    std::vector<frame> frames;
+
+    inline std::string_view::size_type next() {
+        if (k >= positions.size()) {
+            throw exception{s, s.size()};
+        }
+        return positions[k++];
+    }
+
+    inline char peek() const {
+        return k < positions.size() ? s[positions[k]] : '\0';
+    }
+
+    // scalars have no closing position, so make sure nothing but spaces follows them
+    inline void check_scalar_end(const std::string_view::size_type j) const {
+        if (j < s.size() && !is_space(s[j]) && !(k < positions.size() && positions[k] == j)) {
+            throw exception{s, j};
+        }
+    }
+
+    inline void open(value &&container, const std::string_view::size_type i) {
+        if (frames.size() == limit) {
+            throw exception{s, i};
+        }
+        frames.push_back({std::move(container), {}, {}});
+    }
+
+    value parse_value() {
+        frames.clear();
+        while (true) {
+            std::string_view::size_type i = next();
+            value result = null{};
+            switch (get_type(s[i])) {
+            case type::array:
+                if (peek() == ']') {
+                    ++k;
+                    result = value::array{resource};
+                    break;
+                }
+                open(value::array{resource}, i);
+                continue;
+            case type::boolean:
+                result = s[i] == 't';
+                parse_literal(s, i, s[i] == 't' ? "true" : "false");
+                check_scalar_end(i);
+                break;
+            case type::null:
+                parse_literal(s, i, "null");
+                check_scalar_end(i);
+                break;
+            case type::number:
+                result = parse_number(s, i);
+                check_scalar_end(i);
+                break;
+            case type::object:
+                if (peek() == '}') {
+                    ++k;
+                    result = value::object{resource};
+                    break;
+                }
+                open(value::object{resource}, i);
+                parse_name(frames.back());
                 continue;
+            case type::string: {
+                const std::string_view str = parse_string(i);
+                result = borrow && is_inside(s, str) ? string::borrow(valid_utf8, str) : string{valid_utf8, str, resource};
+                break;
+            }
+            default:
+                throw exception{s, i};
+            }
+            // adds the value to the innermost container, and that one to its own once closed
+            while (true) {
+                if (frames.empty()) {
+                    return result;
+                }
+                frame &f = frames.back();
+                const bool is_array = f.container.is_array();
+                if (is_array) {
+                    f.container.as_array().add(std::move(result));
+                } else {
+                    f.container.as_object().put(shapes, f.unescaped.empty() ? f.name : f.unescaped, std::move(result));
+                }
+                i = next();
+                if (s[i] == ',') {
+                    if (!is_array) {
+                        parse_name(f);
+                    }
+                    break;
+                }
+                if (s[i] != (is_array ? ']' : '}')) {
+                    throw exception{s, i};
+                }
+                result = std::move(f.container);
+                frames.pop_back();
             }
         }
-        break;
     }
-    throw exception{s, i};
-}
 
-static std::string_view::size_type parse(const std::string_view s,
-                                         const std::string_view::size_type i)
+    std::string_view parse_string(const std::string_view::size_type open) {
+        const std::string_view::size_type close = next();
+        if (s[close] != '"') {
+            throw exception{s, open};
+        }
+        return tmp::parse_string(s, open + 1, close, buffer);
+    }
+
+    // "name": of the next member of the object of f
+    void parse_name(frame &f) {
+        std::string_view::size_type i = next();
+        if (s[i] != '"') {
+            throw exception{s, i};
+        }
+        f.name = parse_string(i);
+        f.unescaped.clear();
+        if (f.name.data() == buffer.data()) {
+            // the value may reuse the buffer, and frames move when the stack grows
+            f.unescaped = f.name;
+        }
+        if (i = next(); s[i] != ':') {
+            throw exception{s, i};
+        }
+    }
+};
+
+static constexpr std::size_t parallel_chunk_size = 1 << 20;
+
+// Parses a top level array on threads: its elements are cut at the commas
+// the index has at depth one, and groups of them go to their own index_parser.
+// Anything else is parsed by a single index_parser.
+static value parse_parallel(const std::string_view s,
+                            const structural_index &index,
+                            const unsigned threads,
+                            const std::size_t max_depth = default_max_depth)
 {
-    const std::string_view::size_type pos = skip_spaces(s, i);
-    if (pos >= s.size()) {
-        throw exception{s, i};
+    const std::vector<structural_index::position_t> &positions = index.positions();
+    if (positions.empty() || s[positions[0]] != '[' || index.has_unclosed_string() || max_depth == 0) {
+        return index_parser{s, index, std::pmr::get_default_resource(), false, max_depth}.parse();
+    }
+    // indexes of the opening bracket, the commas and the closing bracket
+    std::vector<std::size_t> separators = {0};
+    std::size_t depth = 0;
+    std::size_t k = 1;
+    for (; k < positions.size(); ++k) {
+        const char c = s[positions[k]];
+        if (c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ']' || c == '}') {
+            if (depth == 0) {
+                break;
+            }
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            separators.push_back(k);
+        }
+    }
+    if (k == positions.size()) {
+        // unclosed, the sequential parser tells where
+        return index_parser{s, index, std::pmr::get_default_resource(), false, max_depth}.parse();
+    }
+    if (s[positions[k]] != ']') {
+        throw exception{s, positions[k]};
     }
-    switch (get_type(s[pos])) {
-    case type::array: return parse_array(s, pos + 1);
-    case type::boolean: return parse_boolean(s, pos + 1);
-    case type::null: return parse_null(s, pos + 1);
-    case type::number: return parse_number(s, pos);
-    case type::object: return parse_object(s, pos + 1);
-    case type::string: return parse_string(s, pos + 1);
-    default: throw exception{s, pos};
+    if (k + 1 < positions.size()) {
+        throw exception{s, positions[k + 1]};
+    }
+    separators.push_back(k);
+    value::array result;
+    if (separators.size() == 2 && separators[1] == 1) {
+        return result;
+    }
+    const std::size_t count = separators.size() - 1;
+    const std::size_t groups = std::min<std::size_t>(count, thread_count(threads) * 8);
+    std::vector<std::vector<value>> elements(groups);
+    run_parallel(groups, threads, [&](const std::size_t g) {
+        // the elements are one level down
+        index_parser parser{s, index, std::pmr::get_default_resource(), false, max_depth - 1};
+        for (std::size_t e = count * g / groups, last = count * (g + 1) / groups; e < last; ++e) {
+            elements[g].push_back(parser.parse(separators[e] + 1, separators[e + 1]));
+        }
+    });
+    for (std::vector<value> &group : elements) {
+        for (value &v : group) {
+            result.add(std::move(v));
+        }
     }
+    return result;
 }
 
 }
 
 namespace json {
 
-value parse(const std::string_view s) {
-    tmp::parse(s, 0);
-    return value{true};
+// Parses s on threads threads, all the cores for 0, when it is larger than
+// tmp::parallel_chunk_size: the index is built by chunks and the elements of
+// a top level array are parsed in groups, see tmp::parse_parallel. Arrays and
+// objects nested deeper than max_depth throw a json::exception.
+inline value parse(const std::string_view s, const unsigned threads, const std::size_t max_depth = tmp::default_max_depth) {
+    if (s.size() <= tmp::structural_index::max_size) {
+        if (s.size() > tmp::parallel_chunk_size && tmp::thread_count(threads) > 1) {
+            const auto index = tmp::structural_index::build(s, threads, tmp::parallel_chunk_size);
+            return tmp::parse_parallel(s, index, threads, max_depth);
+        }
+        const auto index = tmp::structural_index::build(s);
+        return tmp::index_parser{s, index, std::pmr::get_default_resource(), false, max_depth}.parse();
+    }
+    std::string_view::size_type i = 0;
+    value result = tmp::parse(s, i, std::pmr::get_default_resource(), false, max_depth);
+    if (const auto j = tmp::skip_spaces(s, i); j != std::string_view::npos) {
+        throw exception{s, j};
+    }
+    return result;
+}
+
+// parses on the calling thread only, threads are asked for with parse(s, threads)
+inline value parse(const std::string_view s) {
+    return parse(s, 1);
 }
 
-value parse(const char *s) {
+inline value parse(const char *s) {
     return parse(std::string_view{s});
 }
 
-value parse(const std::string &s) {
+inline value parse(const std::string &s) {
     return parse(std::string_view{s});
 }
 
@@ -0,0 +1,390 @@
+#ifndef JSON_QUERY_HPP
+#define JSON_QUERY_HPP
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "document.hpp"
+#include "exception.hpp"
+#include "extract.hpp"
+#include "key.hpp"
+#include "parser.hpp"
+#include "value.hpp"
+
+namespace json::tmp {
+
+// One instruction of a compiled query, selecting children of the current values.
+struct step final {
+    enum class kind: std::uint8_t {
+        member,   // .name or ['name']
+        index,    // [n], negative from the end
+        wildcard, // .* or [*], every member or element
+        descend,  // ..name, the members named name at any depth
+        token     // JSON pointer reference token, a member or an element
+    };
+
+    kind what;
+    key name = std::string_view{};
+    std::int64_t index = -1;
+};
+
+static std::string_view::size_type parse_index(const std::string_view p,
+                                               std::string_view::size_type i,
+                                               std::int64_t &index)
+{
+    const bool negative = i < p.size() && p[i] == '-';
+    const std::string_view::size_type first = i + negative;
+    index = 0;
+    for (i = first; i < p.size() && is_digit(p[i]); ++i) {
+        if (index > (std::numeric_limits<std::int64_t>::max() - (p[i] - '0')) / 10) {
+            throw exception{p, i};
+        }
+        index = index * 10 + (p[i] - '0');
+    }
+    if (i == first || (p[first] == '0' && i - first > 1)) {
+        throw exception{p, first};
+    }
+    index = negative ? -index : index;
+    return i;
+}
+
+// the index a JSON pointer token refers to in an array, or -1
+static std::int64_t token_index(const std::string_view token) {
+    std::int64_t index = -1;
+    if (!token.empty() && is_digit(token[0])) {
+        try {
+            if (parse_index(token, 0, index) != token.size()) {
+                index = -1;
+            }
+        } catch (const exception &) {
+            index = -1;
+        }
+    }
+    return index;
+}
+
+}
+
+namespace json {
+
+// Compiled JSONPath or JSON pointer, see json::compile. Member names are
+// hashed once at compilation and the query runs any number of times, on a
+// value tree or straight on the input. Copies share the compiled names.
+class query final {
+public:
+    // Calls f(const value&) for every match in document order, the value
+    // may be a copy of an element of a typed array living for the call only.
+    template <typename function>
+    void run(const value &root, function &&f) const {
+        walk(root, 0, f);
+    }
+
+    std::vector<value> run(const value &root) const {
+        std::vector<value> result;
+        run(root, [&result](const value &v) {
+            result.push_back(v);
+        });
+        return result;
+    }
+
+    std::vector<value> run(const document &doc) const {
+        return run(doc.root());
+    }
+
+    // Runs on the input, only the matches are parsed, the subtrees they are
+    // not in are skipped without validation like with json::extract.
+    std::vector<value> run(const std::string_view s) const {
+        std::vector<value> result;
+        std::string buffer;
+        std::string_view::size_type i = 0;
+        walk(s, i, 0, 0, result, buffer);
+        return result;
+    }
+
+    std::vector<value> run(const char *s) const {
+        return run(std::string_view{s});
+    }
+
+    friend query compile(std::string_view path);
+
+private:
+    using step = tmp::step;
+
+    std::shared_ptr<const std::string> names; // the characters of the keys
+    std::vector<step> steps;
+
+    template <typename function>
+    void walk(const value &v, const std::size_t k, function &f) const {
+        if (k == steps.size()) {
+            f(v);
+            return;
+        }
+        const step &s = steps[k];
+        switch (s.what) {
+        case step::kind::member:
+            if (v.is_object()) {
+                if (const value *member = v.as_object().get(s.name)) {
+                    walk(*member, k + 1, f);
+                }
+            }
+            break;
+        case step::kind::index:
+            if (v.is_array()) {
+                const auto &a = v.as_array();
+                const std::int64_t size = static_cast<std::int64_t>(a.size());
+                if (const std::int64_t i = s.index < 0 ? size + s.index : s.index; i >= 0 && i < size) {
+                    walk(*a.get(static_cast<std::size_t>(i)), k + 1, f);
+                }
+            }
+            break;
+        case step::kind::wildcard:
+            for_each_child(v, [this, k, &f](const value &child) {
+                walk(child, k + 1, f);
+            });
+            break;
+        case step::kind::descend:
+            if (v.is_object()) {
+                for (const auto &[name, child] : v.as_object()) {
+                    if (s.name == name) {
+                        walk(child, k + 1, f);
+                    }
+                    walk(child, k, f);
+                }
+            } else {
+                for_each_child(v, [this, k, &f](const value &child) {
+                    walk(child, k, f);
+                });
+            }
+            break;
+        case step::kind::token:
+            if (v.is_object()) {
+                if (const value *member = v.as_object().get(s.name)) {
+                    walk(*member, k + 1, f);
+                }
+            } else if (v.is_array() && s.index >= 0 && static_cast<std::size_t>(s.index) < v.as_array().size()) {
+                walk(*v.as_array().get(static_cast<std::size_t>(s.index)), k + 1, f);
+            }
+            break;
+        }
+    }
+
+    template <typename function>
+    static void for_each_child(const value &v, function &&f) {
+        if (v.is_array()) {
+            v.as_array().for_each(f);
+        } else if (v.is_object()) {
+            for (const auto &[name, child] : v.as_object()) {
+                f(child);
+            }
+        }
+    }
+
+    static std::string_view::size_type next(const std::string_view s, const std::string_view::size_type i) {
+        const std::string_view::size_type j = tmp::skip_spaces(s, i);
+        if (j == std::string_view::npos) {
+            throw exception{s, s.size()};
+        }
+        return j;
+    }
+
+    static void expect(const std::string_view s, const std::string_view::size_type i, const char c) {
+        if (s[i] != c) {
+            throw exception{s, i};
+        }
+    }
+
+    // i is at the value, and right after it on return, depth is the number
+    // of containers around it, limited like for json::parse
+    void walk(const std::string_view s,
+              std::string_view::size_type &i,
+              const std::size_t k,
+              const std::size_t depth,
+              std::vector<value> &out,
+              std::string &buffer) const
+    {
+        i = next(s, i);
+        if (k == steps.size()) {
+            out.push_back(tmp::parse(s, i));
+            return;
+        }
+        if ((s[i] == '[' || s[i] == '{') && depth == tmp::default_max_depth) {
+            throw exception{s, i};
+        }
+        if (s[i] == '[') {
+            walk_array(s, i, k, depth + 1, out, buffer);
+        } else if (s[i] == '{') {
+            walk_object(s, i, k, depth + 1, out, buffer);
+        } else {
+            i = tmp::skip_value(s, i);
+        }
+    }
+
+    void walk_array(const std::string_view s,
+                    std::string_view::size_type &i,
+                    const std::size_t k,
+                    const std::size_t depth,
+                    std::vector<value> &out,
+                    std::string &buffer) const
+    {
+        const step &st = steps[k];
+        std::int64_t wanted = st.what == step::kind::index || st.what == step::kind::token ? st.index : -1;
+        if (st.what == step::kind::index && wanted < 0) {
+            // counts the elements first to know where the end is
+            std::int64_t size = 0;
+            std::string_view::size_type j = next(s, i + 1);
+            while (s[j] != ']') {
+                j = next(s, tmp::skip_value(s, j));
+                ++size;
+                if (s[j] == ',') {
+                    j = next(s, j + 1);
+                } else {
+                    expect(s, j, ']');
+                }
+            }
+            wanted += size;
+            if (wanted < 0) {
+                i = j + 1;
+                return;
+            }
+        }
+        i = next(s, i + 1);
+        for (std::int64_t index = 0; s[i] != ']'; ++index) {
+            if (st.what == step::kind::wildcard || index == wanted) {
+                walk(s, i, k + 1, depth, out, buffer);
+            } else if (st.what == step::kind::descend) {
+                walk(s, i, k, depth, out, buffer);
+            } else {
+                i = tmp::skip_value(s, i);
+            }
+            i = next(s, i);
+            if (s[i] == ',') {
+                i = next(s, i + 1);
+            } else {
+                expect(s, i, ']');
+            }
+        }
+        ++i;
+    }
+
+    void walk_object(const std::string_view s,
+                     std::string_view::size_type &i,
+                     const std::size_t k,
+                     const std::size_t depth,
+                     std::vector<value> &out,
+                     std::string &buffer) const
+    {
+        const step &st = steps[k];
+        i = next(s, i + 1);
+        while (s[i] != '}') {
+            expect(s, i, '"');
+            ++i;
+            const std::string_view name = tmp::parse_string(s, i, buffer);
+            const bool matched = st.what == step::kind::wildcard || (st.what != step::kind::index && st.name == name);
+            i = next(s, i);
+            expect(s, i++, ':');
+            if (matched && st.what == step::kind::descend) {
+                std::string_view::size_type j = i;
+                walk(s, j, k + 1, depth, out, buffer);
+                walk(s, i, k, depth, out, buffer);
+            } else if (matched) {
+                walk(s, i, k + 1, depth, out, buffer);
+            } else if (st.what == step::kind::descend) {
+                walk(s, i, k, depth, out, buffer);
+            } else {
+                i = tmp::skip_value(s, next(s, i));
+            }
+            i = next(s, i);
+            if (s[i] == ',') {
+                i = next(s, i + 1);
+            } else {
+                expect(s, i, '}');
+            }
+        }
+        ++i;
+    }
+};
+
+// Compiles a JSON pointer (RFC 6901) when path is empty or starts with a slash,
+// otherwise a JSONPath made of $ followed by .name, ['name'], [n], [-n], .*,
+// [*] and ..name steps. Throws json::exception on a malformed path.
+inline query compile(const std::string_view path) {
+    using step = tmp::step;
+    std::string names;
+    std::vector<std::pair<std::size_t, std::size_t>> ranges; // of the names of the steps
+    query q;
+    const auto add = [&q, &names, &ranges](const step::kind what, const std::string_view name = {}, const std::int64_t index = -1) {
+        ranges.emplace_back(names.size(), name.size());
+        names += name;
+        q.steps.push_back({what, std::string_view{}, index});
+    };
+    if (path.empty() || path[0] == '/') {
+        for (const std::string &token : tmp::split_pointer(path)) {
+            add(step::kind::token, token, tmp::token_index(token));
+        }
+    } else {
+        if (path[0] != '$') {
+            throw exception{path, 0};
+        }
+        for (std::string_view::size_type i = 1, n = path.size(); i < n;) {
+            if (path[i] == '.') {
+                const bool descend = i + 1 < n && path[i + 1] == '.';
+                i += descend ? 2 : 1;
+                if (!descend && i < n && path[i] == '*') {
+                    add(step::kind::wildcard);
+                    ++i;
+                    continue;
+                }
+                const std::string_view::size_type first = i;
+                for (; i < n && path[i] != '.' && path[i] != '['; ++i) {
+                }
+                if (i == first) {
+                    throw exception{path, i};
+                }
+                add(descend ? step::kind::descend : step::kind::member, path.substr(first, i - first));
+            } else if (path[i] == '[' && i + 1 < n) {
+                ++i;
+                if (path[i] == '*') {
+                    add(step::kind::wildcard);
+                    ++i;
+                } else if (path[i] == '\'' || path[i] == '"') {
+                    const char quote = path[i++];
+                    std::string name;
+                    for (; i < n && path[i] != quote; ++i) {
+                        if (path[i] == '\\' && i + 1 < n) {
+                            ++i;
+                        }
+                        name.push_back(path[i]);
+                    }
+                    if (i++ == n) {
+                        throw exception{path, n};
+                    }
+                    add(step::kind::member, name);
+                } else {
+                    std::int64_t index = 0;
+                    i = tmp::parse_index(path, i, index);
+                    add(step::kind::index, {}, index);
+                }
+                if (i >= n || path[i] != ']') {
+                    throw exception{path, i};
+                }
+                ++i;
+            } else {
+                throw exception{path, i};
+            }
+        }
+    }
+    q.names = std::make_shared<const std::string>(std::move(names));
+    for (std::size_t k = 0; k < q.steps.size(); ++k) {
+        q.steps[k].name = std::string_view{*q.names}.substr(ranges[k].first, ranges[k].second);
+    }
+    return q;
+}
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef JSON_SAX_HPP
+#define JSON_SAX_HPP
+
+#include <string_view>
+
+#include "exception.hpp"
+#include "number.hpp"
+#include "parser.hpp"
+
+namespace json {
+
+// No-op callbacks, derive from it and hide the ones you are interested in.
+// String views passed to on_key and on_string are only valid during the call.
+struct sax_handler {
+    inline void on_null() {}
+    inline void on_bool(bool) {}
+    inline void on_number(number) {}
+    inline void on_string(std::string_view) {}
+    inline void on_key(std::string_view) {}
+    inline void on_array_begin() {}
+    inline void on_array_end() {}
+    inline void on_object_begin() {}
+    inline void on_object_end() {}
+};
+
+template <typename handler>
+void sax_parse(const std::string_view s, handler &h, const std::size_t max_depth = tmp::default_max_depth) {
+    std::string_view::size_type i = 0;
+    tmp::reader<handler>{s, h, max_depth}.parse(i);
+    if (const auto j = tmp::skip_spaces(s, i); j != std::string_view::npos) {
+        throw exception{s, j};
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef JSON_SERIALIZER_HPP
+#define JSON_SERIALIZER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "escape.hpp"
+#include "number.hpp"
+#include "value.hpp"
+
+namespace json::tmp {
+
+struct string_sink final {
+    std::string &out;
+
+    inline void write(const char *s, const std::size_t n) {
+        out.append(s, n);
+    }
+
+    inline void put(const char c) {
+        out.push_back(c);
+    }
+
+    inline void fill(const char c, const std::size_t n) {
+        out.append(n, c);
+    }
+};
+
+// Writes as much as fits into the buffer and counts the whole size.
+struct buffer_sink final {
+    char *data;
+    std::size_t capacity;
+    std::size_t size = 0;
+
+    inline void write(const char *s, const std::size_t n) {
+        if (size < capacity) {
+            std::memcpy(data + size, s, std::min(n, capacity - size));
+        }
+        size += n;
+    }
+
+    inline void put(const char c) {
+        if (size < capacity) {
+            data[size] = c;
+        }
+        ++size;
+    }
+
+    inline void fill(const char c, const std::size_t n) {
+        if (size < capacity) {
+            std::memset(data + size, c, std::min(n, capacity - size));
+        }
+        size += n;
+    }
+};
+
+// Same output as value::print, or value::pretty_print when pretty is set,
+// without going through std::ostream.
+template <typename sink, bool pretty>
+class serializer final {
+public:
+    serializer(sink &target): out{target} {}
+
+    void write(const value &v, const std::size_t indent) {
+        if (v.is_array()) {
+            write(v.as_array(), indent);
+        } else if (v.is_boolean()) {
+            write(v.as_boolean() ? std::string_view{"true"} : std::string_view{"false"});
+        } else if (v.is_null()) {
+            write("null");
+        } else if (v.is_number()) {
+            char str[number::max_chars];
+            out.write(str, static_cast<std::size_t>(v.as_number().to_chars(str, str + sizeof(str)) - str));
+        } else if (v.is_object()) {
+            write(v.as_object(), indent);
+        } else {
+            write_string(v.as_string().get_value());
+        }
+    }
+
+private:
+    static constexpr std::size_t indent_step = 4;
+
+    sink &out;
+
+    inline void write(const std::string_view s) {
+        out.write(s.data(), s.size());
+    }
+
+    inline void write_string(const std::string_view s) {
+        out.put('"');
+        write_escaped(out, s);
+        out.put('"');
+    }
+
+    inline void open(const char c) {
+        out.put(c);
+        if constexpr (pretty) {
+            out.put('\n');
+        }
+    }
+
+    inline void close(const char c, const std::size_t indent) {
+        if constexpr (pretty) {
+            out.put('\n');
+            out.fill(' ', indent);
+        }
+        out.put(c);
+    }
+
+    inline void separate(const std::size_t index, const std::size_t indent) {
+        if (index != 0) {
+            out.put(',');
+            if constexpr (pretty) {
+                out.put('\n');
+            }
+        }
+        if constexpr (pretty) {
+            out.fill(' ', indent);
+        }
+    }
+
+    void write(const value::array &a, const std::size_t indent) {
+        if (a.size() == 0 && !pretty) {
+            write("[]");
+            return;
+        }
+        open('[');
+        std::size_t index = 0;
+        a.for_each([this, &index, indent](const value &v) {
+            separate(index++, indent + indent_step);
+            write(v, indent + indent_step);
+        });
+        close(']', indent);
+    }
+
+    void write(const value::object &o, const std::size_t indent) {
+        if (o.size() == 0 && !pretty) {
+            write("{}");
+            return;
+        }
+        open('{');
+        std::size_t index = 0;
+        for (const auto &[k, v] : o) {
+            separate(index++, indent + indent_step);
+            write_string(k);
+            write(pretty ? std::string_view{": "} : std::string_view{":"});
+            write(v, indent + indent_step);
+        }
+        close('}', indent);
+    }
+};
+
+}
+
+namespace json {
+
+// Appends the compact form of v to out, the same characters as v.print.
+inline void serialize(const value &v, std::string &out) {
+    tmp::string_sink sink{out};
+    tmp::serializer<tmp::string_sink, false>{sink}.write(v, 0);
+}
+
+// Appends the indented form of v to out, the same characters as v.pretty_print.
+inline void pretty_serialize(const value &v, std::string &out, const std::size_t indent = 0) {
+    tmp::string_sink sink{out};
+    tmp::serializer<tmp::string_sink, true>{sink}.write(v, indent);
+}
+
+// Writes the compact form of v into [data, data + size) and returns its whole
+// length, the output is truncated when the result is greater than size.
+inline std::size_t serialize_to(const value &v, char *data, const std::size_t size) {
+    tmp::buffer_sink sink{data, size};
+    tmp::serializer<tmp::buffer_sink, false>{sink}.write(v, 0);
+    return sink.size;
+}
+
+}
+
+#endif
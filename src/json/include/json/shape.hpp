@@ -0,0 +1,166 @@
+#ifndef JSON_SHAPE_HPP
+#define JSON_SHAPE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "key.hpp"
+
+namespace json::tmp {
+
+// Ordered member names of an object, shared by every object having exactly
+// these names in this order. Objects store only their values and find them
+// through the shape, which indexes the names above index_threshold.
+// A shared shape is never modified, objects adding a name copy it first.
+class shape final {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+    using name_t = std::pmr::string;
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    static constexpr std::size_t index_threshold = 16;
+
+    shape(const allocator_type &allocator): names{allocator}, slots{allocator} {}
+
+    shape(const shape &s, const allocator_type &allocator): names{s.names, allocator}, slots{s.slots, allocator} {}
+
+    static shape *create(std::pmr::memory_resource *resource, const shape *from = nullptr) {
+        allocator_type allocator{resource};
+        return from ? allocator.new_object<shape>(*from) : allocator.new_object<shape>();
+    }
+
+    static inline void acquire(shape *s) {
+        if (s) {
+            s->uses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static inline void release(shape *s) {
+        if (s && s->uses.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            allocator_type{s->resource()}.delete_object(s);
+        }
+    }
+
+    inline bool is_shared() const {
+        return uses.load(std::memory_order_acquire) > 1;
+    }
+
+    inline std::pmr::memory_resource *resource() const {
+        return names.get_allocator().resource();
+    }
+
+    inline std::size_t size() const {
+        return names.size();
+    }
+
+    inline const name_t &name(const std::size_t position) const {
+        return names[position];
+    }
+
+    // position of the name or npos, hashed is the name itself or a json::key
+    template <typename hashed>
+    std::size_t find(const std::string_view name, const hashed &h) const {
+        if (slots.empty()) {
+            for (std::size_t i = 0, n = names.size(); i < n; ++i) {
+                if (names[i] == name) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+        for (std::size_t mask = slots.size() - 1, i = key_hash{}(h) & mask; slots[i]; i = (i + 1) & mask) {
+            if (names[slots[i] - 1] == name) {
+                return slots[i] - 1;
+            }
+        }
+        return npos;
+    }
+
+    // the shape must not be shared
+    void add(const std::string_view name) {
+        names.emplace_back(name);
+        if (names.size() <= index_threshold) {
+            return;
+        }
+        if (names.size() * 2 > slots.size()) {
+            slots.assign(std::max<std::size_t>(slots.size() * 2, index_threshold * 4), 0);
+            for (std::size_t i = 0, n = names.size(); i < n; ++i) {
+                insert_slot(i);
+            }
+        } else {
+            insert_slot(names.size() - 1);
+        }
+    }
+
+private:
+    std::atomic<std::size_t> uses = 1;
+    std::pmr::vector<name_t> names;
+    std::pmr::vector<std::uint32_t> slots; // position + 1 of the name, 0 when free
+
+    void insert_slot(const std::size_t position) {
+        const std::size_t mask = slots.size() - 1;
+        std::size_t i = key_hash{}(std::string_view{names[position]}) & mask;
+        while (slots[i]) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = static_cast<std::uint32_t>(position + 1);
+    }
+};
+
+// Transitions between shapes used while parsing: adding the same name to the
+// same shape always leads to the same shape, so objects of a record array end
+// up sharing one. The table keeps every shape it refers to alive. Every
+// transition copies the names, so objects only follow them up to max_size
+// names and then add the others to a shape of their own.
+class shape_table final {
+public:
+    static constexpr std::size_t max_size = shape::index_threshold;
+
+    shape_table(std::pmr::memory_resource *allocator = std::pmr::get_default_resource()):
+        resource{allocator}, transitions{allocator}, retained{allocator} {}
+
+    shape_table(const shape_table &) = delete;
+    shape_table &operator=(const shape_table &) = delete;
+
+    ~shape_table() {
+        for (shape *s : retained) {
+            shape::release(s);
+        }
+    }
+
+    // shape with the names of from followed by name, from is null for no names
+    shape *transition(shape *from, const std::string_view name) {
+        const std::size_t h = std::hash<const void*>{}(from) ^ (key_hash{}(name) * 31);
+        auto range = transitions.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.first == from && it->second.second->name(it->second.second->size() - 1) == name) {
+                return it->second.second;
+            }
+        }
+        shape *next = shape::create(resource, from);
+        next->add(name);
+        shape::acquire(from);
+        retained.push_back(from);
+        retained.push_back(next);
+        transitions.emplace(h, std::make_pair(from, next));
+        return next;
+    }
+
+private:
+    std::pmr::memory_resource *resource;
+    std::pmr::unordered_multimap<std::size_t, std::pair<shape*, shape*>> transitions;
+    std::pmr::vector<shape*> retained;
+};
+
+}
+
+#endif
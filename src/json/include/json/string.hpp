@@ -1,23 +1,118 @@
 #ifndef JSON_STRING_HPP
 #define JSON_STRING_HPP
 
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
 #include <ostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+
+#include "escape.hpp"
+#include "exception.hpp"
+#include "tag.hpp"
+#include "utf8.hpp"
 
 namespace json {
 
+// Up to small_capacity characters are stored inline, longer strings live in a
+// block allocated from the memory resource, which is remembered in front of the characters,
+// or stay in a buffer owned by someone else for borrowed strings.
 class string final {
 public:
-    string(const char *s): value{s} {}
-    string(const std::string &s): value{s} {}
-    string(std::string &&s): value{std::move(s)} {}
+    string(const char *s): string{std::string_view{s}} {}
+    string(const std::string &s): string{std::string_view{s}} {}
+
+    // throws json::exception when s isn't valid UTF-8
+    string(const std::string_view s,
+           std::pmr::memory_resource *resource = std::pmr::get_default_resource()):
+        string{tmp::valid_utf8, checked(s), resource} {}
+
+    // for characters already checked, like the ones of the parsers and copies
+    string(tmp::valid_utf8_t,
+           const std::string_view s,
+           std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    {
+        if (s.size() <= small_capacity) {
+            kind = tmp::tag::small_string;
+            // an empty view may have no characters at all
+            if (!s.empty()) {
+                std::memcpy(bytes, s.data(), s.size());
+            }
+            bytes[small_size_offset] = static_cast<char>(s.size());
+        } else {
+            if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error{"json::string is too long"};
+            }
+            kind = tmp::tag::string;
+            void *block = resource->allocate(header_size + s.size(), alignof(std::pmr::memory_resource*));
+            std::memcpy(block, &resource, header_size);
+            char *data = static_cast<char*>(block) + header_size;
+            std::memcpy(data, s.data(), s.size());
+            set_large(static_cast<std::uint32_t>(s.size()), data);
+        }
+    }
+
+    string(const string &s): string{tmp::valid_utf8, s.get_value()} {}
+
+    // Refers to the characters of s without copying them when they don't fit
+    // inline, s must outlive the string and its moves, copies own their characters.
+    static string borrow(const std::string_view s) {
+        return borrow(tmp::valid_utf8, checked(s));
+    }
+
+    static string borrow(tmp::valid_utf8_t, const std::string_view s) {
+        if (s.size() <= small_capacity) {
+            return string{tmp::valid_utf8, s};
+        }
+        if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::length_error{"json::string is too long"};
+        }
+        string result{tmp::valid_utf8, std::string_view{}};
+        result.kind = tmp::tag::borrowed_string;
+        result.set_large(static_cast<std::uint32_t>(s.size()), s.data());
+        return result;
+    }
+
+    string(string &&s) noexcept: kind{s.kind} {
+        std::memcpy(bytes, s.bytes, sizeof(bytes));
+        s.kind = tmp::tag::small_string;
+        s.bytes[small_size_offset] = 0;
+    }
+
+    ~string() {
+        release();
+    }
 
-    inline const std::string &get_value() const {
-        return value;
+    string &operator=(const string &s) {
+        string tmp{s};
+        swap(tmp);
+        return *this;
+    }
+
+    string &operator=(string &&s) noexcept {
+        string tmp{std::move(s)};
+        swap(tmp);
+        return *this;
+    }
+
+    inline std::string_view get_value() const {
+        if (kind == tmp::tag::small_string) {
+            return {bytes, static_cast<std::size_t>(bytes[small_size_offset])};
+        }
+        std::uint32_t size;
+        const char *data;
+        std::memcpy(&size, bytes + large_size_offset, sizeof(size));
+        std::memcpy(&data, bytes + large_data_offset, sizeof(data));
+        return {data, size};
     }
 
     inline void print(std::ostream &out) const {
-        out << '"' << value << '"';
+        out.put('"');
+        tmp::write_escaped(out, get_value());
+        out.put('"');
     }
 
     inline void pretty_print(std::ostream &out, const std::size_t = 0) const {
@@ -25,7 +120,45 @@ public:
     }
 
 private:
-    std::string value;
+    static constexpr std::size_t small_capacity = 14;
+    static constexpr std::size_t small_size_offset = small_capacity;
+    static constexpr std::size_t large_size_offset = 3;
+    static constexpr std::size_t large_data_offset = 7;
+    static constexpr std::size_t header_size = sizeof(std::pmr::memory_resource*);
+
+    tmp::tag kind;
+    char bytes[15];
+
+    static std::string_view checked(const std::string_view s) {
+        if (const std::size_t bad = utf8::find_invalid(s.data(), s.size()); bad != s.size()) {
+            throw exception{s, bad};
+        }
+        return s;
+    }
+
+    inline void set_large(const std::uint32_t size, const char *data) {
+        std::memcpy(bytes + large_size_offset, &size, sizeof(size));
+        std::memcpy(bytes + large_data_offset, &data, sizeof(data));
+    }
+
+    inline void swap(string &s) noexcept {
+        char tmp[sizeof(bytes)];
+        std::memcpy(tmp, bytes, sizeof(bytes));
+        std::memcpy(bytes, s.bytes, sizeof(bytes));
+        std::memcpy(s.bytes, tmp, sizeof(bytes));
+        std::swap(kind, s.kind);
+    }
+
+    void release() {
+        if (kind != tmp::tag::string) {
+            return;
+        }
+        const std::string_view s = get_value();
+        char *block = const_cast<char*>(s.data()) - header_size;
+        std::pmr::memory_resource *resource;
+        std::memcpy(&resource, block, header_size);
+        resource->deallocate(block, header_size + s.size(), alignof(std::pmr::memory_resource*));
+    }
 };
 
 }
@@ -0,0 +1,23 @@
+#ifndef JSON_TAG_HPP
+#define JSON_TAG_HPP
+
+#include <cstdint>
+
+namespace json::tmp {
+
+// First byte of every value alternative, value reads it to know which one is active.
+enum class tag: std::uint8_t {
+    array = 0,
+    boolean,
+    null,
+    integer,
+    real,
+    object,
+    string,
+    small_string,
+    borrowed_string
+};
+
+}
+
+#endif
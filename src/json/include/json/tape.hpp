@@ -0,0 +1,344 @@
+#ifndef JSON_TAPE_HPP
+#define JSON_TAPE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "exception.hpp"
+#include "parser.hpp"
+#include "value.hpp"
+
+namespace json {
+
+// Read only document stored as a flat tape of 64-bit entries: the high byte
+// tells the kind of the entry and the rest is its payload. Containers point
+// past their closing entry, so unused subtrees are skipped in one step, and
+// json::value is only built on demand with element::materialize.
+class tape final {
+public:
+    class element;
+
+    tape(const std::string_view s) {
+        entries.reserve(s.size() / 4 + 2);
+        builder b{*this, {}};
+        std::string_view::size_type i = 0;
+        tmp::reader<builder>{s, b}.parse(i);
+        if (const auto j = tmp::skip_spaces(s, i); j != std::string_view::npos) {
+            throw exception{s, j};
+        }
+    }
+
+    inline element root() const;
+
+    inline std::size_t size() const {
+        return entries.size();
+    }
+
+private:
+    static constexpr int kind_shift = 56;
+    static constexpr std::uint64_t payload_mask = (std::uint64_t{1} << kind_shift) - 1;
+    static constexpr std::uint64_t count_limit = (std::uint64_t{1} << 24) - 1;
+
+    std::vector<std::uint64_t> entries;
+    std::string strings; // 32-bit length followed by the characters
+
+    static constexpr std::uint64_t make(const char kind, const std::uint64_t payload) {
+        return (static_cast<std::uint64_t>(static_cast<unsigned char>(kind)) << kind_shift) | payload;
+    }
+
+    inline char kind(const std::size_t i) const {
+        return static_cast<char>(entries[i] >> kind_shift);
+    }
+
+    inline std::uint64_t payload(const std::size_t i) const {
+        return entries[i] & payload_mask;
+    }
+
+    // index of the entry following the element starting at i
+    inline std::size_t after(const std::size_t i) const {
+        switch (kind(i)) {
+        case '[':
+        case '{': return static_cast<std::uint32_t>(payload(i));
+        case 'l':
+        case 'd': return i + 2;
+        default: return i + 1;
+        }
+    }
+
+    inline std::string_view string_at(const std::size_t i) const {
+        const std::size_t offset = payload(i);
+        std::uint32_t size;
+        std::memcpy(&size, strings.data() + offset, sizeof(size));
+        return {strings.data() + offset + sizeof(size), size};
+    }
+
+    struct builder final {
+        tape &t;
+        std::vector<std::pair<std::size_t, std::uint64_t>> stack; // container entry and its size
+
+        inline void on_null() {
+            add('n', 0);
+        }
+
+        inline void on_bool(const bool b) {
+            add(b ? 't' : 'f', 0);
+        }
+
+        inline void on_number(const number n) {
+            if (n.is_integer()) {
+                add('l', 0);
+                t.entries.push_back(static_cast<std::uint64_t>(n.to_long()));
+            } else {
+                add('d', 0);
+                t.entries.push_back(std::bit_cast<std::uint64_t>(n.to_double()));
+            }
+        }
+
+        inline void on_string(const std::string_view s) {
+            add('"', append(s));
+        }
+
+        inline void on_key(const std::string_view s) {
+            t.entries.push_back(make('"', append(s)));
+        }
+
+        inline void on_array_begin() {
+            open('[');
+        }
+
+        inline void on_array_end() {
+            close('[', ']');
+        }
+
+        inline void on_object_begin() {
+            open('{');
+        }
+
+        inline void on_object_end() {
+            close('{', '}');
+        }
+
+        void add(const char kind, const std::uint64_t payload) {
+            if (!stack.empty()) {
+                ++stack.back().second;
+            }
+            t.entries.push_back(make(kind, payload));
+        }
+
+        std::uint64_t append(const std::string_view s) {
+            if (s.size() > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error{"json::tape string is too long"};
+            }
+            const std::uint64_t offset = t.strings.size();
+            const std::uint32_t size = static_cast<std::uint32_t>(s.size());
+            t.strings.append(reinterpret_cast<const char*>(&size), sizeof(size));
+            t.strings.append(s);
+            return offset;
+        }
+
+        void open(const char kind) {
+            add(kind, 0);
+            stack.emplace_back(t.entries.size() - 1, 0);
+        }
+
+        void close(const char opening, const char closing) {
+            const auto [start, count] = stack.back();
+            stack.pop_back();
+            t.entries.push_back(make(closing, start));
+            const std::uint64_t end = t.entries.size();
+            if (end > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error{"json::tape is too long"};
+            }
+            t.entries[start] = make(opening, (std::min(count, count_limit) << 32) | end);
+        }
+    };
+};
+
+// Cursor to an entry of the tape, it must not outlive the tape.
+class tape::element final {
+public:
+    inline bool is_array() const {
+        return t->kind(index) == '[';
+    }
+
+    inline bool is_boolean() const {
+        return t->kind(index) == 't' || t->kind(index) == 'f';
+    }
+
+    inline bool is_null() const {
+        return t->kind(index) == 'n';
+    }
+
+    inline bool is_number() const {
+        return t->kind(index) == 'l' || t->kind(index) == 'd';
+    }
+
+    inline bool is_integer() const {
+        return t->kind(index) == 'l';
+    }
+
+    inline bool is_object() const {
+        return t->kind(index) == '{';
+    }
+
+    inline bool is_string() const {
+        return t->kind(index) == '"';
+    }
+
+    inline bool get_bool() const {
+        check(is_boolean());
+        return t->kind(index) == 't';
+    }
+
+    inline std::int64_t get_int64() const {
+        check(is_number());
+        const std::uint64_t raw = t->entries[index + 1];
+        return is_integer() ? static_cast<std::int64_t>(raw) : static_cast<std::int64_t>(std::bit_cast<double>(raw));
+    }
+
+    inline double get_double() const {
+        check(is_number());
+        const std::uint64_t raw = t->entries[index + 1];
+        return is_integer() ? static_cast<double>(static_cast<std::int64_t>(raw)) : std::bit_cast<double>(raw);
+    }
+
+    inline std::string_view get_string() const {
+        check(is_string());
+        return t->string_at(index);
+    }
+
+    // number of elements of an array or pairs of an object
+    std::size_t size() const {
+        check(is_array() || is_object());
+        const std::uint64_t count = t->payload(index) >> 32;
+        if (count < count_limit) {
+            return count;
+        }
+        std::size_t n = 0;
+        for (std::size_t i = index + 1, end = t->after(index) - 1; i < end; i = t->after(i)) {
+            i = is_object() ? i + 1 : i;
+            ++n;
+        }
+        return n;
+    }
+
+    // the last member named key, like materialize and json::parse keep
+    element operator[](const std::string_view key) const {
+        check(is_object());
+        std::size_t found = 0;
+        for (std::size_t i = index + 1, end = t->after(index) - 1; i < end; i = t->after(i + 1)) {
+            if (t->string_at(i) == key) {
+                found = i + 1;
+            }
+        }
+        if (found == 0) {
+            throw std::out_of_range{"json::tape::element key not found"};
+        }
+        return {t, found};
+    }
+
+    element operator[](const std::size_t n) const {
+        check(is_array());
+        std::size_t k = 0;
+        for (std::size_t i = index + 1, end = t->after(index) - 1; i < end; i = t->after(i), ++k) {
+            if (k == n) {
+                return {t, i};
+            }
+        }
+        throw std::out_of_range{"json::tape::element index out of range"};
+    }
+
+    // builds the value with a stack of the open containers, not recursively
+    value materialize() const {
+        if (!is_array() && !is_object()) {
+            return scalar();
+        }
+        std::vector<frame> frames;
+        frames.push_back(open(index, 0));
+        while (true) {
+            frame &f = frames.back();
+            if (f.next == f.end) {
+                frame done = std::move(f);
+                frames.pop_back();
+                if (frames.empty()) {
+                    return std::move(done.container);
+                }
+                frames.back().add(*t, done.key, std::move(done.container));
+                continue;
+            }
+            const std::size_t key = f.next;
+            const std::size_t i = f.container.is_object() ? key + 1 : key;
+            f.next = t->after(i);
+            if (t->kind(i) == '[' || t->kind(i) == '{') {
+                frames.push_back(open(i, key));
+            } else {
+                f.add(*t, key, element{t, i}.scalar());
+            }
+        }
+    }
+
+private:
+    friend class tape;
+
+    element(const tape *owner, const std::size_t i): t{owner}, index{i} {}
+
+    const tape *t;
+    std::size_t index;
+
+    // a container being materialized
+    struct frame final {
+        value container;
+        std::size_t next; // entry of the next element, or of the next name in an object
+        std::size_t end;  // entry closing the container
+        std::size_t key;  // entry of the name of the container in its parent object
+
+        void add(const tape &owner, const std::size_t name, value &&v) {
+            if (container.is_object()) {
+                container.as_object().put(owner.string_at(name), std::move(v));
+            } else {
+                container.as_array().add(std::move(v));
+            }
+        }
+    };
+
+    frame open(const std::size_t i, const std::size_t key) const {
+        if (t->kind(i) == '[') {
+            return {value::array{}, i + 1, t->after(i) - 1, key};
+        }
+        return {value::object{}, i + 1, t->after(i) - 1, key};
+    }
+
+    value scalar() const {
+        switch (t->kind(index)) {
+        case '"': return string{get_string()};
+        case 'l': return number{get_int64()};
+        case 'd': return number{get_double()};
+        case 't': return true;
+        case 'f': return false;
+        default: return nullptr;
+        }
+    }
+
+    static inline void check(const bool b) {
+        if (!b) {
+            throw std::bad_variant_access{};
+        }
+    }
+};
+
+inline tape::element tape::root() const {
+    return {this, 0};
+}
+
+}
+
+#endif
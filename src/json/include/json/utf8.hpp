@@ -0,0 +1,15 @@
+#ifndef JSON_UTF8_HPP
+#define JSON_UTF8_HPP
+
+#include "utf8/utf8.hpp"
+
+namespace json::tmp {
+
+// marks characters known to be valid UTF-8 to skip checking them again
+struct valid_utf8_t final {};
+
+inline constexpr valid_utf8_t valid_utf8{};
+
+}
+
+#endif
@@ -2,6 +2,9 @@
 #define JSON_UTILS_HPP
 
 #include <ostream>
+#include <string_view>
+
+#include "escape.hpp"
 
 namespace json::utils {
 
@@ -37,7 +40,9 @@ struct printer final {
 
     template <typename key, typename value>
     inline void print_key_value(std::ostream &out, const key &k, const value &v) const {
-        out << '"' << k << "\":";
+        out.put('"');
+        tmp::write_escaped(out, std::string_view{k});
+        out.write("\":", 2);
         v.print(out);
     }
 
@@ -92,7 +97,9 @@ public:
     template <typename key, typename value>
     inline void print_key_value(std::ostream &out, const key &k, const value &v) const {
         print_value_indent(out);
-        out << '"' << k << "\": ";
+        out.put('"');
+        tmp::write_escaped(out, std::string_view{k});
+        out.write("\": ", 3);
         v.pretty_print(out, get_value_indent());
     }
 
@@ -115,10 +122,12 @@ private:
         return indent + default_indent;
     }
 
-    static inline void print_indent(std::ostream &out, const std::size_t indent) {
-        for (std::size_t i = 0; i < indent; ++i) {
-            out << ' ';
+    static inline void print_indent(std::ostream &out, std::size_t indent) {
+        static constexpr std::string_view spaces = "                                ";
+        for (; indent > spaces.size(); indent -= spaces.size()) {
+            out.write(spaces.data(), spaces.size());
         }
+        out.write(spaces.data(), indent);
     }
 };
 
@@ -0,0 +1,337 @@
+#ifndef JSON_VALIDATE_HPP
+#define JSON_VALIDATE_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <system_error>
+
+#include "escape.hpp"
+#include "parser.hpp"
+#include "utf8.hpp"
+
+namespace json {
+
+// Result of json::validate, offset is where the input stops being valid JSON.
+struct validation final {
+    enum class error: std::uint8_t {
+        none,
+        unexpected_end,
+        unexpected_character,
+        invalid_number,
+        invalid_string,
+        invalid_escape,
+        invalid_utf8,
+        too_deep
+    };
+
+    error code = error::none;
+    std::size_t offset = 0;
+
+    constexpr bool ok() const {
+        return code == error::none;
+    }
+};
+
+}
+
+namespace json::tmp {
+
+// Checks the grammar without recursion, producing nothing and allocating
+// nothing: the kinds of the open containers are bits of a fixed stack,
+// which bounds the nesting to max_depth.
+class validator final {
+public:
+    using error = validation::error;
+
+    static constexpr std::size_t max_depth = default_max_depth;
+    static constexpr std::int64_t max_magnitude = std::int64_t{1} << 50;
+
+    validator(const std::string_view input): s{input} {}
+
+    validation run() {
+        if (!value()) {
+            return result;
+        }
+        while (depth > 0) {
+            if (!space()) {
+                return result;
+            }
+            if (s[i] == (object ? '}' : ']')) {
+                pop();
+                continue;
+            }
+            if (opened) {
+                opened = false;
+            } else if (s[i] == ',') {
+                ++i;
+                if (!space()) {
+                    return result;
+                }
+            } else {
+                fail(error::unexpected_character, i);
+                return result;
+            }
+            if ((object && !member_name()) || !value()) {
+                return result;
+            }
+        }
+        if (const std::size_t j = skip_spaces(s, i); j != std::string_view::npos) {
+            fail(error::unexpected_character, j);
+        }
+        return result;
+    }
+
+private:
+    std::string_view s;
+    std::size_t i = 0;
+    std::size_t depth = 0;
+    bool opened = false;
+    bool object = false; // whether the innermost container is an object
+    std::uint64_t objects[max_depth / 64] = {};
+    validation result;
+
+    inline bool fail(const error code, const std::size_t offset) {
+        result = {code, offset};
+        return false;
+    }
+
+    inline bool push(const bool is_object) {
+        if (depth == max_depth) {
+            return fail(error::too_deep, i);
+        }
+        const std::uint64_t bit = std::uint64_t{1} << (depth % 64);
+        objects[depth / 64] = is_object ? objects[depth / 64] | bit : objects[depth / 64] & ~bit;
+        ++depth;
+        ++i;
+        opened = true;
+        object = is_object;
+        return true;
+    }
+
+    inline void pop() {
+        ++i;
+        --depth;
+        opened = false;
+        object = depth && (objects[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1;
+    }
+
+    // moves to the next character which is not a space, which must exist
+    inline bool space() {
+        if (i < s.size() && !is_space(s[i])) {
+            return true;
+        }
+        const std::size_t j = skip_spaces(s, i);
+        if (j == std::string_view::npos) {
+            return fail(error::unexpected_end, s.size());
+        }
+        i = j;
+        return true;
+    }
+
+    // "name" followed by a colon
+    bool member_name() {
+        if (s[i] != '"') {
+            return fail(error::unexpected_character, i);
+        }
+        if (!string() || !space()) {
+            return false;
+        }
+        if (s[i] != ':') {
+            return fail(error::unexpected_character, i);
+        }
+        ++i;
+        return true;
+    }
+
+    bool value() {
+        if (!space()) {
+            return false;
+        }
+        switch (s[i]) {
+        case '[': return push(false);
+        case '{': return push(true);
+        case '"': return string();
+        case 't': return literal("true");
+        case 'f': return literal("false");
+        case 'n': return literal("null");
+        default: return number();
+        }
+    }
+
+    bool literal(const std::string_view l) {
+        for (std::size_t k = 0; k < l.size(); ++k) {
+            if (i + k == s.size()) {
+                return fail(error::unexpected_end, s.size());
+            }
+            if (s[i + k] != l[k]) {
+                return fail(error::unexpected_character, i + k);
+            }
+        }
+        i += l.size();
+        return true;
+    }
+
+    inline std::size_t digits(std::size_t j) const {
+        for (; j < s.size() && is_digit(s[j]); ++j) {
+        }
+        return j;
+    }
+
+    // numbers too large for a double are invalid like for parse_number, the
+    // magnitude tells the ones std::from_chars has to check
+    bool number() {
+        std::size_t j = i + (s[i] == '-');
+        if (j == s.size()) {
+            return fail(error::unexpected_end, j);
+        }
+        std::int64_t magnitude = 0;
+        if (s[j] == '0') {
+            ++j;
+        } else if (is_digit(s[j])) {
+            const std::size_t first = j;
+            j = digits(j);
+            magnitude = static_cast<std::int64_t>(j - first);
+        } else {
+            return fail(j == i ? error::unexpected_character : error::invalid_number, j);
+        }
+        if (j < s.size() && s[j] == '.') {
+            const std::size_t first = ++j;
+            if ((j = digits(j)) == first) {
+                return fail(error::invalid_number, j);
+            }
+        }
+        if (j < s.size() && (s[j] == 'e' || s[j] == 'E')) {
+            ++j;
+            const bool negative = j < s.size() && s[j] == '-';
+            j += j < s.size() && (s[j] == '+' || s[j] == '-');
+            const std::size_t first = j;
+            std::int64_t e = 0;
+            for (; j < s.size() && is_digit(s[j]); ++j) {
+                e = e < max_magnitude ? e * 10 + (s[j] - '0') : e;
+            }
+            if (j == first) {
+                return fail(error::invalid_number, j);
+            }
+            magnitude += negative ? -e : e;
+        }
+        if (magnitude > std::numeric_limits<double>::max_exponent10) {
+            double d;
+            if (std::from_chars(s.data() + i, s.data() + j, d).ec == std::errc::result_out_of_range) {
+                return fail(error::invalid_number, i);
+            }
+        }
+        i = j;
+        return true;
+    }
+
+    // i is at the opening quote and right after the closing one on success,
+    // short runs are checked in place and long ones by find_escape
+    bool string() {
+        const char *p = s.data();
+        const std::size_t n = s.size();
+        std::size_t j = i + 1;
+        while (true) {
+            std::size_t run = j;
+            for (; run < n && run < j + 16; ++run) {
+                if (static_cast<unsigned char>(p[run]) >= 0x80 || needs_escape(p[run])) {
+                    break;
+                }
+            }
+            if (run < n && (run == j + 16 || static_cast<unsigned char>(p[run]) >= 0x80)) {
+                const std::size_t k = run;
+                run += find_escape(p + k, n - k);
+                if (const std::size_t bad = utf8::find_invalid(p + k, run - k); bad != run - k) {
+                    return fail(error::invalid_utf8, k + bad);
+                }
+            }
+            j = run;
+            if (j == n) {
+                return fail(error::unexpected_end, n);
+            }
+            if (p[j] == '"') {
+                i = j + 1;
+                return true;
+            }
+            if (p[j] != '\\') {
+                return fail(error::invalid_string, j);
+            }
+            if ((j = escape(j + 1)) == std::string_view::npos) {
+                return false;
+            }
+        }
+    }
+
+    inline bool hex4(const std::size_t j, std::uint32_t &code) {
+        code = 0;
+        for (std::size_t k = j; k < j + 4; ++k) {
+            if (k == s.size()) {
+                return fail(error::unexpected_end, k);
+            }
+            const int d = hex_digit(s[k]);
+            if (d < 0) {
+                return fail(error::invalid_escape, k);
+            }
+            code = (code << 4) | static_cast<std::uint32_t>(d);
+        }
+        return true;
+    }
+
+    // j points right after the backslash, returns the index after the escape or npos
+    std::size_t escape(const std::size_t j) {
+        if (j == s.size()) {
+            fail(error::unexpected_end, j);
+            return std::string_view::npos;
+        }
+        switch (s[j]) {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            return j + 1;
+        case 'u':
+            break;
+        default:
+            fail(error::invalid_escape, j);
+            return std::string_view::npos;
+        }
+        std::uint32_t code;
+        if (!hex4(j + 1, code)) {
+            return std::string_view::npos;
+        }
+        if (code >= 0xDC00 && code <= 0xDFFF) {
+            fail(error::invalid_escape, j);
+            return std::string_view::npos;
+        }
+        if (code < 0xD800 || code > 0xDBFF) {
+            return j + 5;
+        }
+        std::uint32_t low;
+        if (!match(s, j + 5, "\\u")) {
+            fail(error::invalid_escape, j + 5);
+            return std::string_view::npos;
+        }
+        if (!hex4(j + 7, low)) {
+            return std::string_view::npos;
+        }
+        if (low < 0xDC00 || low > 0xDFFF) {
+            fail(error::invalid_escape, j + 5);
+            return std::string_view::npos;
+        }
+        return j + 11;
+    }
+};
+
+}
+
+namespace json {
+
+// Checks that s holds exactly one JSON value in valid UTF-8 without building
+// anything or allocating, the nesting is limited to tmp::validator::max_depth
+// and numbers to the range of a double, like for json::parse.
+inline validation validate(const std::string_view s) {
+    return tmp::validator{s}.run();
+}
+
+}
+
+#endif
@@ -1,7 +1,11 @@
 #ifndef JSON_VALUE_HPP
 #define JSON_VALUE_HPP
 
+#include <cstring>
+#include <new>
 #include <ostream>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 #include "array.hpp"
@@ -10,95 +14,231 @@
 #include "number.hpp"
 #include "object.hpp"
 #include "string.hpp"
+#include "tag.hpp"
 
 namespace json {
 
+// Union of the alternatives, each of them starts with its tmp::tag, which
+// keeps a value in 16 bytes.
 class value final {
 public:
     using array = tmp::array<value>;
     using object = tmp::object<value>;
 
-    value(const array &a): content{a} {}
-    value(array &&a): content{std::move(a)} {}
-    value(boolean b): content{b} {}
-    value(bool b): content{boolean{b}} {}
-    value(null n): content{n} {}
-    value(std::nullptr_t): content{null{}} {}
-    value(const number &n): content{n} {}
-    value(number &&n): content{std::move(n)} {}
-    value(int i): content{number{i}} {}
-    value(long l): content{number{l}} {}
-    value(double d): content{number{d}} {}
-    value(const object &o): content{o} {}
-    value(object &&o): content{std::move(o)} {}
-    value(const string &s): content{s} {}
-    value(string &&s): content{std::move(s)} {}
-    value(const char *s): content{string{s}} {}
+    value(const array &a): array_value{a} {}
+    value(array &&a): array_value{std::move(a)} {}
+    value(boolean b): boolean_value{b} {}
+    value(bool b): boolean_value{b} {}
+    value(null n): null_value{n} {}
+    value(std::nullptr_t): null_value{} {}
+    value(const number &n): number_value{n} {}
+    value(number &&n): number_value{n} {}
+    value(int i): number_value{i} {}
+    value(long l): number_value{static_cast<std::int64_t>(l)} {}
+    value(double d): number_value{d} {}
+    value(const object &o): object_value{o} {}
+    value(object &&o): object_value{std::move(o)} {}
+    value(const string &s): string_value{s} {}
+    value(string &&s): string_value{std::move(s)} {}
+    value(const char *s): string_value{s} {}
+
+    value(const value &v) {
+        construct(v);
+    }
+
+    value(value &&v) noexcept {
+        construct(std::move(v));
+    }
+
+    ~value() {
+        destroy();
+    }
+
+    value &operator=(const value &v) {
+        if (this != &v) {
+            value tmp{v};
+            destroy();
+            construct(std::move(tmp));
+        }
+        return *this;
+    }
+
+    value &operator=(value &&v) noexcept {
+        if (this != &v) {
+            destroy();
+            construct(std::move(v));
+        }
+        return *this;
+    }
 
     inline bool is_array() const {
-        return content.index() == 0;
+        return kind() == tmp::tag::array;
     }
 
     inline bool is_boolean() const {
-        return content.index() == 1;
+        return kind() == tmp::tag::boolean;
     }
 
     inline bool is_null() const {
-        return content.index() == 2;
+        return kind() == tmp::tag::null;
     }
 
     inline bool is_number() const {
-        return content.index() == 3;
+        const tmp::tag t = kind();
+        return t == tmp::tag::integer || t == tmp::tag::real;
     }
 
     inline bool is_object() const {
-        return content.index() == 4;
+        return kind() == tmp::tag::object;
     }
 
     inline bool is_string() const {
-        return content.index() == 5;
+        const tmp::tag t = kind();
+        return t == tmp::tag::string || t == tmp::tag::small_string || t == tmp::tag::borrowed_string;
     }
 
     inline array &as_array() {
-        return std::get<array>(content);
+        check(is_array());
+        return array_value;
+    }
+
+    inline const array &as_array() const {
+        check(is_array());
+        return array_value;
     }
 
     inline boolean &as_boolean() {
-        return std::get<boolean>(content);
+        check(is_boolean());
+        return boolean_value;
+    }
+
+    inline const boolean &as_boolean() const {
+        check(is_boolean());
+        return boolean_value;
     }
 
     inline null &as_null() {
-        return std::get<null>(content);
+        check(is_null());
+        return null_value;
+    }
+
+    inline const null &as_null() const {
+        check(is_null());
+        return null_value;
     }
 
     inline number &as_number() {
-        return std::get<number>(content);
+        check(is_number());
+        return number_value;
+    }
+
+    inline const number &as_number() const {
+        check(is_number());
+        return number_value;
     }
 
     inline object &as_object() {
-        return std::get<object>(content);
+        check(is_object());
+        return object_value;
+    }
+
+    inline const object &as_object() const {
+        check(is_object());
+        return object_value;
     }
 
     inline string &as_string() {
-        return std::get<string>(content);
+        check(is_string());
+        return string_value;
+    }
+
+    inline const string &as_string() const {
+        check(is_string());
+        return string_value;
     }
 
     inline void print(std::ostream &out) const {
-        std::visit([&out](auto &&v) {
+        visit([&out](auto &&v) {
             v.print(out);
-        }, content);
+        });
     }
 
     inline void pretty_print(std::ostream &out, const std::size_t indent = 0) const {
-        std::visit([&out, indent](auto &&v) {
+        visit([&out, indent](auto &&v) {
             v.pretty_print(out, indent);
-        }, content);
+        });
     }
 
 private:
-    std::variant<array, boolean, null, number, object, string> content;
+    union {
+        array array_value;
+        boolean boolean_value;
+        null null_value;
+        number number_value;
+        object object_value;
+        string string_value;
+    };
+
+    inline tmp::tag kind() const {
+        tmp::tag t;
+        std::memcpy(&t, static_cast<const void*>(this), sizeof(t));
+        return t;
+    }
+
+    static inline void check(const bool b) {
+        if (!b) {
+            throw std::bad_variant_access{};
+        }
+    }
+
+    template <typename visitor>
+    void visit(visitor &&f) const {
+        switch (kind()) {
+        case tmp::tag::array: f(array_value); break;
+        case tmp::tag::boolean: f(boolean_value); break;
+        case tmp::tag::null: f(null_value); break;
+        case tmp::tag::integer:
+        case tmp::tag::real: f(number_value); break;
+        case tmp::tag::object: f(object_value); break;
+        case tmp::tag::string:
+        case tmp::tag::small_string:
+        case tmp::tag::borrowed_string: f(string_value); break;
+        }
+    }
+
+    template <typename other>
+    void construct(other &&v) {
+        using value_t = std::conditional_t<std::is_lvalue_reference_v<other>, const value &, value &&>;
+        value_t src = static_cast<value_t>(v);
+        switch (v.kind()) {
+        case tmp::tag::array: new (&array_value) array{std::forward<value_t>(src).array_value}; break;
+        case tmp::tag::boolean: new (&boolean_value) boolean{src.boolean_value}; break;
+        case tmp::tag::null: new (&null_value) null{}; break;
+        case tmp::tag::integer:
+        case tmp::tag::real: new (&number_value) number{src.number_value}; break;
+        case tmp::tag::object: new (&object_value) object{std::forward<value_t>(src).object_value}; break;
+        case tmp::tag::string:
+        case tmp::tag::small_string:
+        case tmp::tag::borrowed_string: new (&string_value) string{std::forward<value_t>(src).string_value}; break;
+        }
+    }
+
+    void destroy() {
+        switch (kind()) {
+        case tmp::tag::array: array_value.~array(); break;
+        case tmp::tag::object: object_value.~object(); break;
+        case tmp::tag::string: string_value.~string(); break;
+        default: break;
+        }
+    }
 };
 
+static_assert(sizeof(value) == 16, "json::value must stay 16 bytes");
+static_assert(std::is_standard_layout_v<value::array> && std::is_standard_layout_v<boolean> &&
+              std::is_standard_layout_v<null> && std::is_standard_layout_v<number> &&
+              std::is_standard_layout_v<value::object> && std::is_standard_layout_v<string>,
+              "value alternatives must start with their tag");
+
 using array = value::array;
 using object = value::object;
 
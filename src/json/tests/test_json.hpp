@@ -1,9 +1,19 @@
 #ifndef TEST_JSON_HPP
 #define TEST_JSON_HPP
 
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory_resource>
+#include <optional>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "json/json.hpp"
 
@@ -14,6 +24,24 @@ static std::string print(const type &value) {
     return out.str();
 }
 
+struct recorder final: json::sax_handler {
+    std::string events;
+
+    void on_null() { events += "z"; }
+    void on_bool(bool b) { events += b ? "t" : "f"; }
+    void on_number(json::number n) {
+        std::ostringstream out;
+        n.print(out);
+        events += out.str();
+    }
+    void on_string(std::string_view s) { (events += '"') += s; }
+    void on_key(std::string_view k) { (events += '.') += k; }
+    void on_array_begin() { events += "["; }
+    void on_array_end() { events += "]"; }
+    void on_object_begin() { events += "{"; }
+    void on_object_end() { events += "}"; }
+};
+
 template <typename type>
 static std::string pretty_print(const type &value) {
     std::ostringstream out;
@@ -21,11 +49,48 @@ static std::string pretty_print(const type &value) {
     return out.str();
 }
 
+struct address final {
+    std::string city;
+    std::int32_t zip = 0;
+};
+
+JSON_FIELDS(address, city, zip);
+
+struct node final {
+    std::vector<node> children;
+};
+
+JSON_FIELDS(node, children);
+
+struct account final {
+    std::uint64_t id = 0;
+    std::string name;
+    double score = 0;
+    bool active = false;
+    std::vector<std::string> tags;
+    std::optional<address> home;
+    std::vector<address> offices;
+    std::optional<std::int16_t> level = 3;
+    json::value extra = nullptr;
+};
+
+JSON_FIELDS(account, id, name, score, active, tags, home, offices, level, extra);
+
+struct renamed final {
+    int x = 0;
+    std::vector<bool> flags;
+};
+
+template <>
+struct json::fields<renamed> {
+    static constexpr auto list = std::make_tuple(json::field("the x", &renamed::x), json::field("flags", &renamed::flags));
+};
+
 void test_array() {
     json::array a{1, 2.5, "hello", nullptr, false};
     a.add(json::object{"name1", 123, "name2", "value2"})
         .add(json::array{5, "world"});
-    assert(print(a) == R"([1,2.5,"hello",null,false,{"name2":"value2","name1":123},[5,"world"]])");
+    assert(print(a) == R"([1,2.5,"hello",null,false,{"name1":123,"name2":"value2"},[5,"world"]])");
     assert(pretty_print(a) ==
 R"([
     1,
@@ -34,8 +99,8 @@ R"([
     null,
     false,
     {
-        "name2": "value2",
-        "name1": 123
+        "name1": 123,
+        "name2": "value2"
     },
     [
         5,
@@ -49,9 +114,215 @@ R"([
     for (const auto &e : a) {
         e.print(out << '|');
     }
-    assert(out.str() == R"(|1|2.5|"hello"|null|false|{"name2":"value2","name1":123}|[5,"world"])");
+    assert(out.str() == R"(|1|2.5|"hello"|null|false|{"name1":123,"name2":"value2"}|[5,"world"])");
     assert(print(json::array{}) == "[]");
     assert(pretty_print(json::array{}) == "[\n\n]");
+
+    using storage = json::array::storage;
+    const json::value integers = json::parse("[1, -2, 3]");
+    const auto &i = integers.as_array();
+    assert(i.get_storage() == storage::integers && i.size() == 3);
+    assert(i.integers()[1] == -2 && i.integers().size() == 3);
+    std::string serialized;
+    json::serialize(integers, serialized);
+    assert(serialized == "[1,-2,3]" && print(i) == "[1,-2,3]" && i.get_storage() == storage::integers);
+
+    // reading a const array leaves the storage alone, even from threads
+    assert(i.get(1).as_number().to_long() == -2 && i.get(1).is_number());
+    const json::value element = i.get(2);
+    assert(element.as_number().to_long() == 3);
+    std::int64_t iterated = 0;
+    for (const auto &e : i) {
+        iterated += e->as_number().to_long();
+    }
+    assert(iterated == 2 && i.get_storage() == storage::integers);
+    std::vector<std::thread> readers;
+    std::atomic<std::int64_t> read{0};
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&i, &read] {
+            for (std::size_t k = 0; k < i.size(); ++k) {
+                read += (*i.get(k)).as_number().to_long();
+            }
+        });
+    }
+    for (std::thread &t : readers) {
+        t.join();
+    }
+    assert(read == 8 && i.get_storage() == storage::integers);
+
+    const json::value reals = json::parse("[1.5, 2.5, -3e2]");
+    assert(reals.as_array().get_storage() == storage::reals);
+    assert(reals.as_array().reals()[0] == 1.5 && reals.as_array().reals()[2] == -300.0);
+    assert(print(reals) == "[1.5,2.5,-300]");
+
+    // integers and reals mixed stay values and keep their kind
+    for (const std::string_view s : {"[1, 2.5, -3]", "[2.5, 1, -3]"}) {
+        const json::value mixed = json::parse(s);
+        const auto &m = mixed.as_array();
+        assert(m.get_storage() == storage::values && m.size() == 3);
+        assert(m.get(2).as_number().is_integer() && m.get(2).as_number().to_long() == -3);
+        assert(m.get(0).as_number().is_integer() == (s[1] == '1'));
+    }
+    assert(print(json::parse("[1, 2.5, -3]")) == "[1,2.5,-3]");
+    json::array promoted{1, 2};
+    promoted.add(0.5);
+    assert(promoted.get_storage() == storage::values && promoted.get(1).as_number().is_integer());
+
+    json::value inexact = json::parse("[9007199254740993, 0.5]");
+    assert(inexact.as_array().get_storage() == storage::values);
+    assert(inexact.as_array().get(0).as_number().to_long() == 9007199254740993L);
+
+    json::array booleans{true, false, true};
+    assert(booleans.get_storage() == storage::booleans && booleans.booleans().size() == 3);
+    const json::array copy = booleans;
+    assert(copy.get_storage() == storage::booleans && print(copy) == "[true,false,true]");
+    booleans.add(nullptr);
+    assert(booleans.get_storage() == storage::values && print(booleans) == "[true,false,true,null]");
+    assert(copy.get_storage() == storage::booleans);
+
+    json::array numbers{1, 2};
+    std::int64_t sum = 0;
+    numbers.for_each([&sum](const json::value &v) {
+        sum += v.as_number().to_long();
+    });
+    assert(sum == 3 && numbers.get_storage() == storage::integers);
+    numbers.get(0) = "one";
+    assert(numbers.get_storage() == storage::values && print(numbers) == R"(["one",2])");
+
+    // moved from arrays, alone or in values, are empty and usable
+    json::array moved{1, 2, 3};
+    const json::array target = std::move(moved);
+    assert(target.size() == 3 && moved.size() == 0 && print(moved) == "[]");
+    assert(moved.begin() == moved.end() && moved.get_storage() == storage::values);
+    moved.add(4).add("five");
+    assert(print(moved) == R"([4,"five"])");
+    json::array reassigned = std::move(moved);
+    moved = json::array{true};
+    assert(print(moved) == "[true]" && print(reassigned) == R"([4,"five"])");
+    json::value holder = json::array{1, "x"};
+    const json::value taken = std::move(holder);
+    assert(holder.is_array() && holder.as_array().size() == 0 && print(holder) == "[]");
+    holder.as_array().add(nullptr);
+    assert(print(holder) == "[null]" && print(taken) == R"([1,"x"])");
+    const json::array copied = std::move(reassigned);
+    const json::array copy_of_moved = reassigned;
+    assert(copy_of_moved.size() == 0 && copied.size() == 2);
+
+    bool thrown = false;
+    try {
+        i.reals();
+    } catch (const std::bad_variant_access &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_binding() {
+    // views would dangle, so they can't be members read from JSON
+    static_assert(json::tmp::owning_string<std::string> && json::tmp::owning_string<json::string>);
+    static_assert(!json::tmp::owning_string<std::string_view>);
+
+    const auto a = json::parse<account>(R"({
+        "name": "some\u0020one", "id": 18446744073709551615, "unknown": {"a": [1, "}"]},
+        "score": -2.5e1, "active": true, "tags": ["a", "b"],
+        "home": {"city": "Springfield", "zip": 12345},
+        "offices": [{"zip": 1}, {"city": "Shelbyville"}],
+        "level": null, "extra": [1, {"b": null}]
+    })");
+    assert(a.id == std::numeric_limits<std::uint64_t>::max());
+    assert(a.name == "some one");
+    assert(a.score == -25);
+    assert(a.active);
+    assert((a.tags == std::vector<std::string>{"a", "b"}));
+    assert(a.home && a.home->city == "Springfield" && a.home->zip == 12345);
+    assert(a.offices.size() == 2 && a.offices[0].zip == 1 && a.offices[1].city == "Shelbyville");
+    assert(!a.level);
+    assert(print(a.extra) == R"([1,{"b":null}])");
+
+    // members missing from the input keep their value
+    account b;
+    b.name = "kept";
+    json::parse(R"({"id": 7, "level": 9, "tags": []})", b);
+    assert(b.id == 7 && b.name == "kept" && b.level == 9 && b.tags.empty() && b.extra.is_null());
+
+    const auto r = json::parse<renamed>(R"( {"flags": [true, false, true], "the x": -3} )");
+    assert(r.x == -3);
+    assert((r.flags == std::vector<bool>{true, false, true}));
+    assert(json::parse<renamed>("{}").x == 0);
+    const auto list = json::parse<std::vector<address>>(R"([{"city": "a"}, {"zip": 2}])");
+    assert(list.size() == 2 && list[0].city == "a" && list[1].zip == 2);
+
+    std::string out;
+    json::serialize(a, out);
+    assert(out == R"({"id":18446744073709551615,"name":"some one","score":-25,"active":true,"tags":["a","b"],)"
+                  R"("home":{"city":"Springfield","zip":12345},"offices":[{"city":"","zip":1},{"city":"Shelbyville","zip":0}],)"
+                  R"("level":null,"extra":[1,{"b":null}]})");
+    assert(json::parse<account>(out).offices[1].city == "Shelbyville");
+
+    out.clear();
+    json::serialize(renamed{1, {true, false}}, out);
+    assert(out == R"({"the x":1,"flags":[true,false]})");
+    out.clear();
+    json::serialize(std::vector<address>{{"q\"\n", 0}}, out);
+    assert(out == R"([{"city":"q\"\n","zip":0}])");
+
+    char buffer[8];
+    assert(json::serialize_to(address{"abc", 12}, buffer, sizeof(buffer)) == 23);
+    assert(std::string_view(buffer, sizeof(buffer)) == R"({"city":)");
+
+    const auto invalid = [](const std::string_view s) {
+        try {
+            json::parse<account>(s);
+        } catch (const json::exception &) {
+            return true;
+        }
+        return false;
+    };
+    assert(invalid(R"({"id": -1})"));
+    assert(invalid(R"({"id": 1.5})"));
+    assert(invalid(R"({"id": 01})"));
+    assert(invalid(R"({"id": 18446744073709551616})"));
+    assert(invalid(R"({"level": 40000})"));
+    assert(invalid(R"({"name": 1})"));
+    assert(invalid(R"({"active": yes})"));
+    assert(invalid(R"({"tags": ["a" "b"]})"));
+    assert(invalid(R"({"home": {"zip": 1})"));
+    assert(invalid(R"({"id": 1} x)"));
+    assert(invalid(R"([])"));
+
+    // self-referential types nest as deep as the input, within the limit of json::parse
+    const auto nested = [](const std::size_t depth) {
+        std::string s;
+        for (std::size_t k = 1; k < depth; ++k) {
+            s += R"({"children": [)";
+        }
+        s += "{}";
+        for (std::size_t k = 1; k < depth; ++k) {
+            s += "]}";
+        }
+        return s;
+    };
+    const std::size_t limit = json::tmp::default_max_depth;
+    const node deep = json::parse<node>(nested(limit / 2));
+    assert(deep.children.size() == 1 && deep.children[0].children.size() == 1);
+    bool thrown = false;
+    try {
+        json::parse<node>(nested(limit));
+    } catch (const json::exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    thrown = false;
+    try {
+        std::string unclosed;
+        for (int k = 0; k < 100000; ++k) {
+            unclosed += R"({"children":[)";
+        }
+        json::parse<node>(unclosed);
+    } catch (const json::exception &) {
+        thrown = true;
+    }
+    assert(thrown);
 }
 
 void test_boolean() {
@@ -66,6 +337,322 @@ void test_boolean() {
     assert(pretty_print(f) == "false");
 }
 
+void test_document() {
+    struct counting_resource final: std::pmr::memory_resource {
+        std::size_t allocations = 0;
+        std::size_t allocated = 0;
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++allocations;
+            allocated += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    std::string data = "[";
+    for (int i = 0; i < 1000; ++i) {
+        data += i == 0 ? "" : ",";
+        data += R"({"id":)" + std::to_string(i) + R"(,"name":"a rather long item name number )" + std::to_string(i);
+        data += R"(","tags":["first tag","second tag"],"nested":{"k\"ey":"v\nalue","ok":true}})";
+    }
+    data += "]";
+
+    counting_resource upstream;
+    {
+        json::document doc{data, &upstream};
+        const json::value &root = doc.root();
+        assert(root.as_array().size() == 1000);
+        const auto &nested = root.as_array().get(999).as_object().get("nested")->as_object();
+        assert(nested.get("k\"ey")->as_string().get_value() == "v\nalue");
+        assert(print(root) == print(json::parse(data)));
+    }
+    assert(upstream.allocations > 0 && upstream.allocations < 8);
+
+    const auto inside = [](const std::string_view whole, const std::string_view part) {
+        return part.data() >= whole.data() && part.data() < whole.data() + whole.size();
+    };
+    {
+        json::document doc{data, json::pinned};
+        const auto &item = doc.root().as_array().get(999).as_object();
+        const std::string_view name = item.get("name")->as_string().get_value();
+        assert(name == "a rather long item name number 999" && inside(data, name));
+        const std::string_view unescaped = item.get("nested")->as_object().get("k\"ey")->as_string().get_value();
+        assert(unescaped == "v\nalue" && !inside(data, unescaped));
+        assert(print(doc.root()) == print(json::parse(data)));
+
+        const json::value copy = doc.root();
+        const std::string_view copied = copy.as_array().get(999).as_object().get("name")->as_string().get_value();
+        assert(copied == name && !inside(data, copied));
+    }
+    {
+        std::string owned = data;
+        const char *begin = owned.data();
+        json::document doc{std::move(owned)};
+        const std::string_view name = doc.root().as_array().get(0).as_object().get("name")->as_string().get_value();
+        assert(name == "a rather long item name number 0" && inside({begin, data.size()}, name));
+    }
+    {
+        // the single pass parser used above structural_index::max_size borrows the same way
+        std::string_view::size_type i = 0;
+        const std::string_view s = R"(["a string longer than fourteen characters", "escaped\tone that is long enough"])";
+        const json::value v = json::tmp::parse(s, i, std::pmr::get_default_resource(), true);
+        assert(inside(s, v.as_array().get(0).as_string().get_value()));
+        assert(!inside(s, v.as_array().get(1).as_string().get_value()));
+    }
+
+    bool thrown = false;
+    try {
+        json::document doc{"[1, 2"};
+    } catch (const json::exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_extract() {
+    static constexpr std::string_view data = R"({
+        "skipped": {"a": [1, "]}\\", {"b": "\"}"}], "c": nul},
+        "user": {"name": "x", "id": 42, "tags": ["p", "q"]},
+        "a/b": {"m~n": true},
+        "event": {"ts": 1700000000123, "payload": [
+    })";
+    const auto r = json::extract(data, {"/user/id", "/user/tags/1", "/a~1b/m~0n", "/user"});
+    assert(r.size() == 4);
+    assert(r[0] && print(*r[0]) == "42");
+    assert(r[1] && print(*r[1]) == R"("q")");
+    assert(r[2] && print(*r[2]) == "true");
+    assert(r[3] && r[3]->as_object().size() == 3);
+
+    // stops before the truncated payload once everything is found
+    const auto ts = json::extract(data, {"/event/ts"});
+    assert(ts[0] && ts[0]->as_number().to_long() == 1700000000123);
+
+    const auto missing = json::extract(R"({"user": {"id": 1}, "list": [0, 1]})", {"/user/name", "/list/2", "/list/1", ""});
+    assert(!missing[0] && !missing[1]);
+    assert(missing[2] && print(*missing[2]) == "1");
+    assert(missing[3] && missing[3]->is_object());
+
+    const auto invalid = [](const std::string_view s, const std::string_view p) {
+        try {
+            json::extract(s, {p});
+        } catch (const json::exception &) {
+            return true;
+        }
+        return false;
+    };
+    assert(invalid(R"({"user": {"id": 1})", "/user/name"));
+    assert(invalid(R"({"user" 1})", "/user"));
+    assert(invalid(R"({"a": 1})", "a"));
+    assert(invalid(R"({"a": 1})", "/a~2"));
+}
+
+void test_incremental() {
+    static constexpr std::string_view data = R"( {"a\"b": [1, -2.5e3, "x\ny\u00e9\ud83d\ude00", true, false, null, {}],
+        "c": {"d": [[], {"e": 12345}]}, "f": "\\\"", "g": 0} )";
+    recorder expected;
+    json::sax_parse(data, expected);
+
+    for (std::size_t i = 0; i <= data.size(); ++i) {
+        recorder r;
+        json::incremental_parser<recorder> p{r};
+        p.feed(data.substr(0, i));
+        p.feed(data.substr(i));
+        p.finish();
+        assert(r.events == expected.events);
+    }
+
+    {
+        recorder r;
+        json::incremental_parser<recorder> p{r};
+        for (const char c : data) {
+            p.feed(std::string_view{&c, 1});
+        }
+        p.finish();
+        assert(r.events == expected.events);
+    }
+
+    {
+        recorder r;
+        json::incremental_parser<recorder> p{r};
+        p.feed("-12");
+        p.feed("34.5");
+        p.finish();
+        assert(r.events == "-1234.5");
+    }
+
+    static constexpr const char *invalid[] = {"", "[1,]", "[1", R"({"a" 1})", "[] x", R"("\q")", "tru", "1-2", R"("\ud800x")", "{]", "\"\xff\""};
+    for (const char *s : invalid) {
+        bool thrown = false;
+        try {
+            json::sax_handler h;
+            json::incremental_parser<json::sax_handler> p{h};
+            p.feed(s);
+            p.finish();
+        } catch (const json::exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+void test_index() {
+    std::string data = R"( {"a\"b":[1,-2.5e3,true,false,null],"c\\":"}{][:,","d":{"e":"\\\"x\\"}} )";
+    for (int i = 0; i < 100; ++i) {
+        data += R"({"key\\\\":"value\\\"",  "n":[12345, 0.5, true], "s":"\\"} )";
+        data += std::string(static_cast<std::size_t>(i % 7), ' ');
+        data += std::string(static_cast<std::size_t>(i % 5), '\\');
+    }
+    for (std::size_t n = 0; n <= data.size(); ++n) {
+        const std::string_view s{data.data(), n};
+        const auto scalar = json::tmp::structural_index::build<json::tmp::scalar_classifier>(s);
+        const auto simd = json::tmp::structural_index::build(s);
+        assert(scalar.positions() == simd.positions());
+        assert(scalar.has_unclosed_string() == simd.has_unclosed_string());
+        const auto baseline = json::tmp::structural_index::build<json::tmp::default_classifier>(s);
+        assert(scalar.positions() == baseline.positions());
+        assert(scalar.has_unclosed_string() == baseline.has_unclosed_string());
+#ifdef JSON_X86
+        if (json::tmp::cpu_has_avx2()) {
+            const auto avx2 = json::tmp::structural_index::build<json::tmp::avx2_classifier>(s);
+            assert(scalar.positions() == avx2.positions());
+            assert(scalar.has_unclosed_string() == avx2.has_unclosed_string());
+        }
+#endif
+        for (const std::size_t chunk_size : {1, 7, 100}) {
+            const auto chunked = json::tmp::structural_index::build(s, 3, chunk_size);
+            assert(chunked.positions() == simd.positions());
+            assert(chunked.has_unclosed_string() == simd.has_unclosed_string());
+        }
+    }
+
+    // every byte value at every position of a block gets the same masks
+    for (int c = 0; c < 256; ++c) {
+        for (std::size_t k = 0; k < 64; k += 5) {
+            char block[64];
+            std::memset(block, 'a', sizeof(block));
+            block[k] = static_cast<char>(c);
+            block[63 - k] = static_cast<char>(255 - c);
+            const auto same = [](const json::tmp::block_masks &a, const json::tmp::block_masks &b) {
+                return a.quote == b.quote && a.backslash == b.backslash && a.op == b.op && a.space == b.space;
+            };
+            const auto expected = json::tmp::scalar_classifier::classify(block);
+            assert(same(expected, json::tmp::default_classifier::classify(block)));
+#ifdef JSON_X86
+            if (json::tmp::cpu_has_avx2()) {
+                assert(same(expected, json::tmp::avx2_classifier::classify(block)));
+            }
+#endif
+        }
+    }
+
+    {
+        const std::string_view s = R"( {"a":[1, "x\"y",true]} )";
+        const auto index = json::tmp::structural_index::build<json::tmp::scalar_classifier>(s);
+        const std::vector<json::tmp::structural_index::position_t> expected = {1, 2, 4, 5, 6, 7, 8, 10, 15, 16, 17, 21, 22};
+        assert(index.positions() == expected);
+    }
+
+    std::string big = "[";
+    for (int i = 0; i < 1000; ++i) {
+        big += i == 0 ? "" : ",";
+        big += R"({"id":)" + std::to_string(i) + R"(,"name":"item \")" + std::to_string(i) + R"(\"","tags":["a","b\\"],"ok":true})";
+    }
+    big += "]";
+    std::string_view::size_type i = 0;
+    json::value expected = json::tmp::parse(big, i);
+    json::value v = json::parse(big);
+    assert(v.as_array().size() == 1000);
+    assert(print(v.as_array().get(999).as_object().get("name")->as_string()) == R"("item \"999\"")");
+    for (std::size_t j = 0; j < 1000; ++j) {
+        assert(print(*v.as_array().get(j).as_object().get("tags")) == print(*expected.as_array().get(j).as_object().get("tags")));
+    }
+
+    // top level arrays are parsed by groups of elements on threads
+    const auto parallel = [](const std::string_view s) {
+        return json::tmp::parse_parallel(s, json::tmp::structural_index::build(s, 4, 16), 4);
+    };
+    assert(print(parallel(big)) == print(expected));
+    assert(print(parallel(" [ ] ")) == "[]");
+    assert(print(parallel("[1]")) == "[1]");
+    assert(print(parallel(R"([[1, [2]], {"a": [3, "],"]}, "x", 4.5, null])")) == R"([[1,[2]],{"a":[3,"],"]},"x",4.5,null])");
+    assert(print(parallel(R"({"a": [1, 2]})")) == R"({"a":[1,2]})");
+    assert(print(parallel("7")) == "7");
+    assert(print(json::parse(big, 4)) == print(expected));
+    for (const std::string_view s : {"[1 2]", "[1,]", "[,1]", "[1,,2]", "[1, 2}", "[1] 2", "[[1], 2", "[\"a]", "[{]}", "[1, {\"a\" 1}]"}) {
+        bool thrown = false;
+        try {
+            parallel(s);
+        } catch (const json::exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+void test_lines() {
+    std::string data;
+    for (int i = 0; i < 1000; ++i) {
+        data += i % 7 == 0 ? "\n  \r\n" : "";
+        data += R"({"id": )" + std::to_string(i) + R"(, "text": "line\nfeed"})" + (i % 3 == 0 ? "\r\n" : "\n");
+    }
+    data += "[1]";
+    for (const unsigned threads : {1u, 4u}) {
+        std::vector<json::value> values;
+        const auto collect = [&values](json::value &&v) {
+            values.push_back(std::move(v));
+        };
+        json::tmp::line_parser{data, threads, 64}.run(collect);
+        assert(values.size() == 1001);
+        for (std::int64_t i = 0; i < 1000; ++i) {
+            assert(values[i].as_object().get("id")->as_number().to_long() == i);
+        }
+        assert(print(values.back()) == "[1]");
+
+        std::size_t count = 0;
+        json::parse_lines(data, [&count](json::value &&) {
+            ++count;
+        }, threads);
+        assert(count == 1001);
+
+        // records parsed together share the shapes of their objects
+        values.clear();
+        json::parse_lines(data, collect, threads);
+        assert(values[1].as_object().same_shape(values[2].as_object()));
+
+        std::istringstream in{data};
+        values.clear();
+        json::parse_lines(in, collect, threads, 100);
+        assert(values.size() == 1001 && print(values.back()) == "[1]");
+        assert(values[500].as_object().get("id")->as_number().to_long() == 500);
+    }
+
+    // the records before a malformed line are delivered first
+    std::string broken = data.substr(0, data.find("\"id\": 600"));
+    broken += "{\n" + data;
+    std::size_t delivered = 0;
+    try {
+        json::tmp::line_parser{broken, 4, 64}.run([&delivered](json::value &&) {
+            ++delivered;
+        });
+        assert(false);
+    } catch (const json::exception &) {
+    }
+    assert(delivered == 600);
+
+    std::istringstream empty{""};
+    json::parse_lines(empty, [](json::value &&) {
+        assert(false);
+    });
+}
+
 void test_null() {
     json::null n;
     assert(print(n) == "null");
@@ -88,28 +675,95 @@ void test_number() {
         assert(print(n) == "123456789.12345");
         assert(pretty_print(n) == "123456789.12345");
     }
+
+    const auto parse = [](const std::string_view s) {
+        std::string_view::size_type i = 0;
+        const json::number n = json::tmp::parse_number(s, i);
+        assert(i == s.size());
+        return n;
+    };
+    assert(parse("0").is_integer() && parse("0").to_long() == 0);
+    assert(parse("-17").is_integer() && parse("-17").to_long() == -17);
+    assert(parse("9007199254740993").to_long() == 9007199254740993L);
+    assert(parse("9223372036854775807").to_long() == std::numeric_limits<std::int64_t>::max());
+    assert(parse("-9223372036854775808").to_long() == std::numeric_limits<std::int64_t>::min());
+    assert(!parse("9223372036854775808").is_integer());
+    assert(parse("9223372036854775808").to_double() == 9223372036854775808.0);
+    assert(parse("123456789012345678901234567890").to_double() == 123456789012345678901234567890.0);
+    assert(!parse("1e2").is_integer() && parse("1e2").to_double() == 100.0);
+    assert(!parse("1.0").is_integer());
+    assert(parse("0.1").to_double() == 0.1);
+    assert(parse("-0.000123").to_double() == -0.000123);
+    assert(parse("3.141592653589793").to_double() == 3.141592653589793);
+    assert(parse("1e23").to_double() == 1e23);
+    assert(parse("2.2250738585072014E-308").to_double() == 2.2250738585072014e-308);
+    assert(parse("1.7976931348623157e308").to_double() == 1.7976931348623157e308);
+    assert(parse("5e-324").to_double() == 5e-324);
+    assert(parse("0.30000000000000004441").to_double() == 0.30000000000000004441);
+    assert(parse("1000000000000000000000.5").to_double() == 1000000000000000000000.5);
+    assert(parse("0e99999999").to_double() == 0.0);
+    assert(std::signbit(parse("-0.0").to_double()));
+
+    // numbers too small for a double are zeros of their sign, too large ones
+    // are rejected by the parsers and validate alike, so printing round trips
+    const std::string long_integer = "1" + std::string(400, '0');
+    const std::string long_fraction = "0." + std::string(400, '0') + "1";
+    for (const auto &[s, d] : std::initializer_list<std::pair<std::string_view, double>>{
+             {"1e-400", 0.0}, {"-1e-400", -0.0}, {"4e-99999999999", 0.0}, {long_fraction, 0.0},
+             {"0.0001e-320", 0.0}, {"1e308", 1e308}, {"0.1e309", 1e308}, {"1.7976931348623157e308", 1.7976931348623157e308}}) {
+        assert(parse(s).to_double() == d && std::signbit(parse(s).to_double()) == std::signbit(d));
+        assert(json::validate(s).ok());
+        const json::value v = json::parse("[" + std::string{s} + "]");
+        assert(v.as_array().reals()[0] == d && json::parse(print(v)).as_array().get(0).as_number().to_double() == d);
+    }
+    for (const std::string_view s : {std::string_view{"1e400"}, std::string_view{"-1e400"}, std::string_view{"123e56789012345678901"},
+                                     std::string_view{"1.5E+309"}, std::string_view{long_integer}, std::string_view{"0.2e310"},
+                                     std::string_view{"1.7976931348623159e308"}}) {
+        const auto throws_on = [](const std::string &input) {
+            try {
+                json::parse(input);
+            } catch (const json::exception &) {
+                return true;
+            }
+            return false;
+        };
+        assert(throws_on(std::string{s}) && throws_on("[0, " + std::string{s} + "]"));
+        const json::validation result = json::validate("[0, " + std::string{s} + "]");
+        assert(result.code == json::validation::error::invalid_number && result.offset == 4);
+    }
+
+    assert(print(json::number{0.1}) == "0.1");
+    assert(print(json::number{0.1 + 0.2}) == "0.30000000000000004");
+    assert(print(json::number{1e23}) == "1e+23");
+    assert(print(json::number{-2.5e-300}) == "-2.5e-300");
+    assert(print(json::number{std::numeric_limits<std::int64_t>::min()}) == "-9223372036854775808");
+    for (const double d : {1.0 / 3, 2.2250738585072014e-308, 1.7976931348623157e308, 5e-324, -123456.789e100}) {
+        char str[json::number::max_chars];
+        const char *end = json::number{d}.to_chars(str, str + sizeof(str));
+        assert(parse({str, static_cast<std::size_t>(end - str)}).to_double() == d);
+    }
 }
 
 void test_object() {
     json::object o{"qwert", nullptr, "asdfg", "hello"};
     o.put("object", json::object{"name1", json::array{}, "name2", "value2"})
         .put("array", json::array{1, true, "name"});
-    assert(print(o) == R"({"array":[1,true,"name"],"object":{"name2":"value2","name1":[]},"qwert":null,"asdfg":"hello"})");
+    assert(print(o) == R"({"qwert":null,"asdfg":"hello","object":{"name1":[],"name2":"value2"},"array":[1,true,"name"]})");
     assert(pretty_print(o) ==
 R"({
-    "array": [
-        1,
-        true,
-        "name"
-    ],
+    "qwert": null,
+    "asdfg": "hello",
     "object": {
-        "name2": "value2",
         "name1": [
 
-        ]
+        ],
+        "name2": "value2"
     },
-    "qwert": null,
-    "asdfg": "hello"
+    "array": [
+        1,
+        true,
+        "name"
+    ]
 })");
     assert(o.get("object")->as_object().get("name2")->as_string().get_value() == "value2");
 
@@ -117,9 +771,102 @@ R"({
     for (const auto &p : o) {
         out << p.first << '|';
     }
-    assert(out.str() == "array|object|qwert|asdfg|");
+    assert(out.str() == "qwert|asdfg|object|array|");
     assert(print(json::object{}) == "{}");
     assert(pretty_print(json::object{}) == "{\n\n}");
+
+    // above 16 pairs the lookups go through the hash index, the order stays the same
+    json::object big;
+    std::string expected = "{";
+    for (int i = 0; i < 100; ++i) {
+        const std::string name = "key" + std::to_string(99 - i);
+        big.put(name, i);
+        expected += (i == 0 ? "\"" : ",\"") + name + "\":" + std::to_string(i);
+    }
+    assert(print(big) == expected + "}");
+    big.put("key99", "replaced");
+    assert(big.size() == 100 && big.get("key99")->as_string().get_value() == "replaced");
+    const json::object copy = big;
+    for (int i = 0; i < 100; ++i) {
+        assert(copy.get("key" + std::to_string(99 - i)) != nullptr);
+        assert(big.get(json::key{"key" + std::to_string(i)}) == big.get("key" + std::to_string(i)));
+    }
+    assert(!copy.get("key100") && !big.get(json::key{"missing"}));
+    assert(print(json::parse(R"({"b":1,"a":2,"b":3})")) == R"({"b":3,"a":2})");
+
+    // parsed objects with the same names in the same order share their shape
+    const json::value records = json::parse(R"([{"id":1,"name":"a"},{"id":2,"name":"b"},{"name":"c","id":3},{"id":4}])");
+    const auto &r = records.as_array();
+    assert(r.get(0).as_object().same_shape(r.get(1).as_object()));
+    assert(!r.get(0).as_object().same_shape(r.get(2).as_object()));
+    assert(!r.get(0).as_object().same_shape(r.get(3).as_object()));
+    assert(r.get(2).as_object().get("id")->as_number().to_long() == 3);
+    json::value changed = r.get(1);
+    assert(changed.as_object().same_shape(r.get(1).as_object()));
+    changed.as_object().put("extra", true);
+    assert(!changed.as_object().same_shape(r.get(1).as_object()));
+    assert(print(changed) == R"({"id":2,"name":"b","extra":true})");
+    assert(print(records) == R"([{"id":1,"name":"a"},{"id":2,"name":"b"},{"name":"c","id":3},{"id":4}])");
+    {
+        json::document doc{R"([{"a":1,"b":2},{"a":3,"b":4}])"};
+        const auto &d = doc.root().as_array();
+        assert(d.get(0).as_object().same_shape(d.get(1).as_object()));
+        changed = d.get(1);
+        assert(!changed.as_object().same_shape(d.get(1).as_object()));
+    }
+    assert(print(changed) == R"({"a":3,"b":4})" && changed.as_object().get("b")->as_number().to_long() == 4);
+
+    struct counting_resource final: std::pmr::memory_resource {
+        std::size_t allocations = 0;
+        std::size_t allocated = 0;
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++allocations;
+            allocated += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    json::object l{"a member name longer than the small string buffer", 1, "another rather long member name", 2};
+    const json::key name{"another rather long member name"};
+    counting_resource counter;
+    std::pmr::memory_resource *previous = std::pmr::set_default_resource(&counter);
+    const bool found = l.get("a member name longer than the small string buffer")->as_number().to_long() == 1 &&
+                       l.get(std::string_view{"another rather long member name"})->as_number().to_long() == 2 &&
+                       l.get(name)->as_number().to_long() == 2 &&
+                       !l.get("a missing member with a long name") &&
+                       !l.get(json::key{"a missing member with a long name"});
+    std::pmr::set_default_resource(previous);
+    assert(found && counter.allocations == 0);
+    assert(l.get(std::string{"another rather long member name"}) == l.get(name));
+    assert(name.get_name() == "another rather long member name");
+
+    // shapes are shared up to a size, a large object of unique names costs
+    // memory in proportion to its size
+    std::string wide = "{";
+    for (int i = 0; i < 20000; ++i) {
+        wide += (i ? ",\"" : "\"") + std::to_string(i) + "\":" + std::to_string(i);
+    }
+    wide += "}";
+    for (int parser = 0; parser < 2; ++parser) {
+        counting_resource bytes;
+        previous = std::pmr::set_default_resource(&bytes);
+        std::string_view::size_type i = 0;
+        const json::value v = parser ? json::parse(wide) : json::tmp::parse(wide, i);
+        std::pmr::set_default_resource(previous);
+        assert(v.as_object().size() == 20000 && v.as_object().get("19999")->as_number().to_long() == 19999);
+        assert(bytes.allocated < 100 * wide.size());
+    }
+    const json::value wide_records = json::parse("[" + wide + "," + wide + "]");
+    assert(!wide_records.as_array().get(0).as_object().same_shape(wide_records.as_array().get(1).as_object()));
 }
 
 void test_parser() {
@@ -180,16 +927,436 @@ void test_parser() {
 
     try {
         json::value v = json::parse(data);
+        auto &test = v.as_object().get("quiz")->as_object().get("test")->as_object();
+        assert(test.size() == 9);
+        assert(test.get("true")->as_boolean());
+        assert(!test.get("false")->as_boolean());
+        assert(test.get("null")->is_null());
+        assert(test.get("number1")->as_number().to_double() == -1.234567890);
+        assert(test.get("number2")->as_number().to_double() == 0.123e5);
+        assert(test.get("number3")->as_number().to_double() == -0.123e+5);
+        assert(test.get("number4")->as_number().to_double() == -0.123E-5);
+        assert(test.get("array")->as_array().size() == 0);
+        assert(test.get("object")->as_object().size() == 0);
+
+        auto &maths = v.as_object().get("quiz")->as_object().get("maths")->as_object();
+        auto &q1 = maths.get("q1")->as_object();
+        assert(q1.get("question")->as_string().get_value() == "5 + 7 = ?");
+        assert(print(*q1.get("options")) == "[10,11,12,13]");
+        assert(q1.get("answer")->as_number().to_long() == 12);
     } catch (const json::exception &e) {
         std::cout << e.what() << std::endl;
         assert(false);
     }
+
+    static constexpr const char *round_trips[] = {
+        "null",
+        "true",
+        "false",
+        "0",
+        "-123",
+        "9223372036854775807",
+        "2.5",
+        R"("")",
+        R"("Hello, world!")",
+        "[]",
+        "{}",
+        R"([1,2.5,"hello",null,false,{"name":"value"},[5,"world"],[],{}])",
+        R"({"object":{"array":[1,true,{"key":[]}]}})"
+    };
+    for (const char *s : round_trips) {
+        assert(print(json::parse(s)) == s);
+    }
+
+    {
+        json::array a{1, 2.5, "hello", nullptr, false, json::array{5, "world"}, json::object{"name", 123}};
+        assert(print(json::parse(pretty_print(a))) == print(a));
+        assert(pretty_print(json::parse(print(a))) == pretty_print(a));
+    }
+
+    assert(json::parse(" \t\r\n[ 1 , 2 ] \n").as_array().size() == 2);
+    assert(json::parse(R"("a\"b\\c\/d\be\ff\ng\rh\ti")").as_string().get_value() == "a\"b\\c/d\be\ff\ng\rh\ti");
+    assert(json::parse(R"("\u0041\u00e9\u20ac\ud83d\ude00")").as_string().get_value() == "A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+    assert(json::parse("-9223372036854775808").as_number().to_long() == INT64_MIN);
+    assert(json::parse("18446744073709551616").as_number().to_double() == 18446744073709551616.0);
+
+    static constexpr const char *invalid[] = {
+        "",
+        " ",
+        "[",
+        "[1,]",
+        "[1 2]",
+        "{",
+        R"({"a"})",
+        R"({"a":})",
+        R"({"a":1,})",
+        R"({a:1})",
+        R"("abc)",
+        "\"a\nb\"",
+        R"("\x")",
+        R"("\u12")",
+        R"("\ud800")",
+        "tru",
+        "fals",
+        "nul",
+        "-",
+        "01",
+        "1.",
+        ".5",
+        "1e",
+        "1e+",
+        "--1",
+        "[] []",
+        "1 2"
+    };
+    for (const char *s : invalid) {
+        bool thrown = false;
+        try {
+            json::parse(s);
+        } catch (const json::exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+        thrown = false;
+        try {
+            json::sax_handler h;
+            json::sax_parse(s, h);
+        } catch (const json::exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+
+    // nesting is limited instead of overflowing the stack
+    const auto nested = [](const std::size_t depth) {
+        std::string s;
+        for (std::size_t k = 0; k < depth; ++k) {
+            s += k % 2 ? R"({"k\u0041":)" : "[";
+        }
+        s += "1";
+        for (std::size_t k = depth; k-- > 0;) {
+            s += k % 2 ? "}" : "]";
+        }
+        return s;
+    };
+    const auto throws = [](auto &&f) {
+        try {
+            f();
+        } catch (const json::exception &) {
+            return true;
+        }
+        return false;
+    };
+    const std::size_t limit = json::tmp::default_max_depth;
+    const std::string deepest = nested(limit);
+    json::value v = json::parse(deepest);
+    for (std::size_t k = 0; k < limit; ++k) {
+        v = k % 2 ? json::value{*v.as_object().get(std::string{"kA"})} : json::value{v.as_array().get(0)};
+    }
+    assert(v.as_number().to_long() == 1);
+    assert(print(json::parse(deepest, 1, limit)) == print(json::document{deepest}.root()));
+    json::sax_handler h;
+    json::sax_parse(deepest, h);
+    const std::string too_deep = nested(limit + 1);
+    assert(throws([&too_deep] { json::parse(too_deep); }));
+    assert(throws([&too_deep] { json::document doc{too_deep}; }));
+    assert(throws([&too_deep, &h] { json::sax_parse(too_deep, h); }));
+    const std::string hostile(1 << 20, '[');
+    assert(throws([&hostile] { json::parse(hostile); }));
+    assert(throws([&hostile, &h] { json::sax_parse(hostile, h); }));
+    assert(json::parse(nested(5000), 1, 5000).is_array());
+    assert(throws([] { json::parse("[[1]]", 1, 1); }));
+    assert(throws([&h] { json::sax_parse("[[1]]", h, 1); }));
+    assert(print(json::parse("[[1]]", 1, 2)) == "[[1]]");
+    assert(print(json::parse("1", 1, 0)) == "1");
+}
+
+void test_query() {
+    static constexpr std::string_view data = R"({
+        "items": [
+            {"name": "a", "price": 10, "tags": {"price": -1}},
+            {"name": "b\"", "price": 2.5},
+            {"name": "c"}
+        ],
+        "a/b": {"m~n": [true, false]},
+        "it's": 7,
+        "price": 1
+    })";
+    const json::value v = json::parse(data);
+    const auto prints = [](const auto &values) {
+        std::string result;
+        for (const auto &e : values) {
+            if constexpr (std::is_pointer_v<std::remove_cvref_t<decltype(e)>>) {
+                result += print(*e) + ";";
+            } else {
+                result += print(e) + ";";
+            }
+        }
+        return result;
+    };
+    const auto check = [&v, &prints](const std::string_view path, const std::string_view expected) {
+        const json::query q = json::compile(path);
+        assert(prints(q.run(v)) == expected);
+        assert(prints(q.run(data)) == expected);
+        const json::query copy = q;
+        assert(prints(copy.run(v)) == expected);
+    };
+    check("$.items[*].price", "10;2.5;");
+    check("$['items'][1].name", R"("b\"";)");
+    check("$.items[-1]", R"({"name":"c"};)");
+    check("$.items[-4]", "");
+    check("$.items[3]", "");
+    check("$.items[0].*", R"("a";10;{"price":-1};)");
+    check("$..price", "10;-1;2.5;1;");
+    check(R"($["it's"])", "7;");
+    check("$['a/b']['m~n'][1]", "false;");
+    check("$.price.x", "");
+    check("$", print(v) + ";");
+    check("/items/1/price", "2.5;");
+    check("/a~1b/m~0n/0", "true;");
+    check("/items/01", "");
+    check("/items/-", "");
+    check("", print(v) + ";");
+
+    json::document doc{data};
+    assert(prints(json::compile("$.items[0].name").run(doc)) == R"("a";)");
+
+    std::size_t count = 0;
+    json::compile("$..name").run(v, [&count](const json::value &) {
+        ++count;
+    });
+    assert(count == 3);
+
+    // the input is walked no deeper than json::parse goes
+    const std::string hostile(1 << 20, '[');
+    bool deep_thrown = false;
+    try {
+        json::compile("$..a").run(hostile);
+    } catch (const json::exception &) {
+        deep_thrown = true;
+    }
+    assert(deep_thrown);
+    const std::size_t limit = json::tmp::default_max_depth;
+    const std::string deep = std::string(limit - 1, '[') + R"({"a":1})" + std::string(limit - 1, ']');
+    assert(prints(json::compile("$..a").run(deep)) == "1;");
+    assert(prints(json::compile("$..a").run(json::parse(deep))) == "1;");
+
+    for (const std::string_view path : {"items", "$.", "$..", "$[", "$[*", "$[1", "$['a", "$[a]", "$[01]", "$x", "/a~2"}) {
+        bool thrown = false;
+        try {
+            json::compile(path);
+        } catch (const json::exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+void test_sax() {
+    recorder r;
+    json::sax_parse(R"( {"a": [1, "x\ny", true, false, null, {}], "b\u0041": {"c": []}} )", r);
+    assert(r.events == "{.a[1\"x\nytfz{}].bA{.c[]}}");
+
+    struct extractor final: json::sax_handler {
+        bool is_id = false;
+        std::int64_t id = 0;
+
+        void on_key(std::string_view k) { is_id = k == "id"; }
+        void on_number(json::number n) {
+            if (is_id) {
+                id = n.to_long();
+            }
+        }
+    };
+
+    extractor e;
+    json::sax_parse(R"({"name": "test", "id": 42, "tags": ["a", "b"]})", e);
+    assert(e.id == 42);
+
+    static constexpr const char *invalid[] = {"", "[1,]", R"({"a" 1})", "[] x", R"("\q")"};
+    for (const char *s : invalid) {
+        bool thrown = false;
+        try {
+            json::sax_handler h;
+            json::sax_parse(s, h);
+        } catch (const json::exception &) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+void test_serializer() {
+    const json::value v = json::parse(R"({
+        "name": "value", "numbers": [1, -2.5, 1e23, 0.1], "empty": [], "nested": {"a": {}, "b": [[], [null]]},
+        "flags": [true, false], "long": "a string longer than fourteen characters"
+    })");
+    for (const json::value &x : {v, json::value{json::array{}}, json::value{json::object{}}, json::value{nullptr},
+                                 json::value{7}, json::value{"s"}}) {
+        std::string out = "prefix";
+        json::serialize(x, out);
+        assert(out == "prefix" + print(x));
+
+        out.clear();
+        json::pretty_serialize(x, out);
+        assert(out == pretty_print(x));
+
+        std::ostringstream indented;
+        x.pretty_print(indented, 8);
+        out.clear();
+        json::pretty_serialize(x, out, 8);
+        assert(out == indented.str());
+    }
+
+    const std::string expected = print(v);
+    std::string buffer(expected.size(), '\0');
+    assert(json::serialize_to(v, buffer.data(), buffer.size()) == expected.size());
+    assert(buffer == expected);
+
+    char small[8];
+    assert(json::serialize_to(v, small, sizeof(small)) == expected.size());
+    assert(std::string_view(small, sizeof(small)) == expected.substr(0, sizeof(small)));
 }
 
 void test_string() {
     json::string s = "Hello, world!";
     assert(print(s) == R"("Hello, world!")");
     assert(pretty_print(s) == R"("Hello, world!")");
+
+    const std::string long_value(100, 'x');
+    json::string l = long_value;
+    assert(l.get_value() == long_value);
+    json::string c = l;
+    assert(c.get_value() == long_value && c.get_value().data() != l.get_value().data());
+    json::string m = std::move(c);
+    assert(m.get_value() == long_value);
+    s = m;
+    assert(s.get_value() == long_value);
+    m = "short";
+    assert(m.get_value() == "short");
+    assert(json::string{""}.get_value().empty());
+    assert(json::string{"14 characters!"}.get_value() == "14 characters!");
+    assert(json::string{"15 characters!!"}.get_value() == "15 characters!!");
+    assert(json::string{std::string_view{}}.get_value().empty());
+    const json::string borrowed = json::string::borrow(long_value);
+    assert(borrowed.get_value().data() == long_value.data() && json::string::borrow(std::string_view{}).get_value().empty());
+
+    const std::string special = std::string{"quote \" backslash \\ controls \b\f\n\r\t"} + '\x01' + '\x1f' + " end";
+    const std::string escaped = R"("quote \" backslash \\ controls \b\f\n\r\t\u0001\u001f end")";
+    assert(print(json::string{special}) == escaped);
+    assert(json::parse(escaped).as_string().get_value() == special);
+    assert(print(json::string{"caf\xc3\xa9 \x7f"}) == "\"caf\xc3\xa9 \x7f\"");
+
+    // escapes on both sides of the 16 and 32 byte blocks
+    for (std::size_t i = 0; i < 70; ++i) {
+        std::string raw(70, 'a');
+        raw[i] = '\n';
+        std::string expected = '"' + raw.substr(0, i) + "\\n" + raw.substr(i + 1) + '"';
+        assert(print(json::string{raw}) == expected);
+        assert(json::parse(expected).as_string().get_value() == raw);
+        std::string out;
+        json::serialize(json::string{raw}, out);
+        assert(out == expected);
+    }
+
+    // every finder the CPU can run stops at the same character
+    for (std::size_t i = 0; i <= 70; ++i) {
+        for (const char e : {'"', '\\', '\x00', '\x1f'}) {
+            std::string raw(70, '\x7f');
+            if (i < raw.size()) {
+                raw[i] = e;
+            }
+            raw += '"';
+            const std::size_t n = raw.size() - 1;
+            assert(json::tmp::scalar_escape_finder::find(raw.data(), n) == i);
+            assert(json::tmp::default_escape_finder::find(raw.data(), n) == i);
+            assert(json::tmp::find_escape(raw.data(), n) == i);
+#ifdef JSON_X86
+            if (json::tmp::cpu_has_avx2()) {
+                assert(json::tmp::avx2_escape_finder::find(raw.data(), n) == i);
+            }
+#endif
+        }
+    }
+
+    const json::value o = json::object{"k\"ey", "v"};
+    assert(print(o) == R"({"k\"ey":"v"})");
+    assert(pretty_print(o) == "{\n    \"k\\\"ey\": \"v\"\n}");
+    std::string out;
+    json::serialize(o, out);
+    assert(out == print(o));
+}
+
+void test_tape() {
+    static constexpr std::string_view data = R"({
+        "user": {"id": 42, "name": "John \"J\" Smith", "scores": [1.5, -2, 1e2], "admin": false},
+        "event": {"ts": 1700000000123, "tags": [], "meta": {}, "note": null},
+        "items": [[1, 2], {"a": true}, "x"]
+    })";
+    json::tape doc{data};
+    const auto root = doc.root();
+    assert(root.is_object() && root.size() == 3);
+    assert(root["user"]["id"].get_int64() == 42);
+    assert(root["user"]["name"].get_string() == "John \"J\" Smith");
+    assert(root["user"]["scores"].size() == 3);
+    assert(root["user"]["scores"][0].get_double() == 1.5);
+    assert(root["user"]["scores"][1].get_int64() == -2);
+    assert(root["user"]["scores"][2].get_double() == 100.0);
+    assert(!root["user"]["admin"].get_bool());
+    assert(root["event"]["ts"].get_int64() == 1700000000123);
+    assert(root["event"]["tags"].size() == 0);
+    assert(root["event"]["meta"].size() == 0);
+    assert(root["event"]["note"].is_null());
+    assert(root["items"][1]["a"].get_bool());
+    assert(root["items"][2].get_string() == "x");
+    assert(print(root["items"].materialize()) == R"([[1,2],{"a":true},"x"])");
+    assert(print(root["user"]["scores"].materialize()) == "[1.5,-2,100]");
+    assert(print(root.materialize()) == print(json::parse(data)));
+    assert(print(root["event"]["note"].materialize()) == "null");
+    std::string deep;
+    for (int i = 0; i < 1000; ++i) {
+        deep += i % 2 ? R"({"k":)" : "[";
+    }
+    deep += "7";
+    for (int i = 999; i >= 0; --i) {
+        deep += i % 2 ? "}" : "]";
+    }
+    assert(print(json::tape{deep}.root().materialize()) == deep);
+
+    // of duplicate keys the last one wins, on the tape like in the value tree
+    const std::string_view duplicates = R"({"a": 1, "b": [2], "a": {"c": 3}, "b": 4})";
+    const json::tape dup{duplicates};
+    assert(print(dup.root()["a"].materialize()) == R"({"c":3})");
+    assert(dup.root()["b"].get_int64() == 4);
+    assert(print(dup.root()["a"].materialize()) == print(*json::parse(duplicates).as_object().get("a")));
+    assert(print(dup.root().materialize()) == print(json::parse(duplicates)));
+
+    bool thrown = false;
+    try {
+        root["user"]["missing"];
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    thrown = false;
+    try {
+        root["items"][3];
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    thrown = false;
+    try {
+        root["user"]["id"].get_string();
+    } catch (const std::bad_variant_access &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    assert(json::tape{"7"}.root().get_int64() == 7);
+    assert(json::tape{R"("s")"}.root().get_string() == "s");
 }
 
 void test_value() {
@@ -214,6 +1381,127 @@ void test_value() {
     assert(!v.is_object());
     assert(!v.is_string());
     assert(v.as_number().to_long() == 777);
+
+    static_assert(sizeof(json::value) == 16);
+    json::array a{1, 2.5, "short", json::string{std::string(64, 'y')}, nullptr, true, json::array{1}, json::object{"k", "v"}};
+    json::array b = a;
+    a.get(3).as_string() = "replaced";
+    assert(print(b) == R"([1,2.5,"short",")" + std::string(64, 'y') + R"(",null,true,[1],{"k":"v"}])");
+    json::value moved = std::move(b);
+    assert(moved.as_array().size() == 8);
+    moved = moved.as_array().get(3);
+    assert(moved.as_string().get_value() == std::string(64, 'y'));
+
+    bool thrown = false;
+    try {
+        moved.as_number();
+    } catch (const std::bad_variant_access &) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void test_utf8() {
+    for (const std::string_view s : {"\"\xc3\"", "[\"a\", \"\xed\xa0\x80\"]", "{\"\xff\": 1}"}) {
+        for (int parser = 0; parser < 4; ++parser) {
+            bool thrown = false;
+            try {
+                if (parser == 0) {
+                    json::parse(s);
+                } else if (parser == 1) {
+                    json::document doc{s};
+                } else if (parser == 2) {
+                    json::tape doc{s};
+                } else {
+                    json::sax_handler h;
+                    json::sax_parse(s, h);
+                }
+            } catch (const json::exception &) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+    }
+    assert(json::parse("\"caf\xc3\xa9\"").as_string().get_value() == "caf\xc3\xa9");
+
+    bool thrown = false;
+    try {
+        json::string bad{"caf\xc3"};
+    } catch (const json::exception &) {
+        thrown = true;
+    }
+    assert(thrown);
+    assert(json::string(json::tmp::valid_utf8, "caf\xc3").get_value() == "caf\xc3");
+}
+
+void test_validate() {
+    using error = json::validation::error;
+    const auto check = [](const std::string_view s, const error code, const std::size_t offset) {
+        const json::validation r = json::validate(s);
+        assert(r.code == code);
+        assert(r.offset == offset);
+        assert(r.ok() == (code == error::none));
+    };
+    for (const std::string_view s : {
+        "0", "-0", " 12.5e-3 ", "1E+9", "true", "null", R"("")", R"("\u00e9\ud83d\ude00\n")",
+        "[]", "{}", R"([1, [2, {}], {"a": [null, false]}])", R"({"k\"": "v", "x": {"y": []}})",
+        "\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\""
+    }) {
+        check(s, error::none, 0);
+        bool parsed = true;
+        try {
+            json::parse(s);
+        } catch (const json::exception &) {
+            parsed = false;
+        }
+        assert(parsed);
+    }
+    check("", error::unexpected_end, 0);
+    check("   ", error::unexpected_end, 3);
+    check("[1, 2", error::unexpected_end, 5);
+    check(R"({"a")", error::unexpected_end, 4);
+    check(R"("abc)", error::unexpected_end, 4);
+    check("tru", error::unexpected_end, 3);
+    check("1 2", error::unexpected_character, 2);
+    check("[1,]", error::unexpected_character, 3);
+    check("[,1]", error::unexpected_character, 1);
+    check(R"({"a" 1})", error::unexpected_character, 5);
+    check(R"({"a": 1,})", error::unexpected_character, 8);
+    check("{1: 2}", error::unexpected_character, 1);
+    check("[1}", error::unexpected_character, 2);
+    check("trux", error::unexpected_character, 3);
+    check("+1", error::unexpected_character, 0);
+    check("01", error::unexpected_character, 1);
+    check("-", error::unexpected_end, 1);
+    check("-a", error::invalid_number, 1);
+    check("1.", error::invalid_number, 2);
+    check("1.e5", error::invalid_number, 2);
+    check("1e+", error::invalid_number, 3);
+    check("\"a\tb\"", error::invalid_string, 2);
+    check(R"("\x")", error::invalid_escape, 2);
+    check(R"("\u12g4")", error::invalid_escape, 5);
+    check(R"("\ude00")", error::invalid_escape, 2);
+    check(R"("\ud83d")", error::invalid_escape, 7);
+    check(R"("\ud83d\u0041")", error::invalid_escape, 7);
+    check("\"\xc3\"", error::invalid_utf8, 1);
+    check("\"a\xc0\xaf\"", error::invalid_utf8, 2);
+    check("\"\xed\xa0\x80\"", error::invalid_utf8, 1);
+    check("\"\xf4\x90\x80\x80\"", error::invalid_utf8, 1);
+    check("\"\xff\"", error::invalid_utf8, 1);
+    check(std::string(40, ' ') + "\"" + std::string(30, 'a') + "\x80\"", error::invalid_utf8, 71);
+
+    const std::size_t depth = json::tmp::validator::max_depth;
+    check(std::string(depth, '[') + std::string(depth, ']'), error::none, 0);
+    check(std::string(depth + 1, '[') + std::string(depth + 1, ']'), error::too_deep, depth);
+    std::string nested;
+    for (std::size_t k = 0; k < 100; ++k) {
+        nested += k % 2 ? R"({"k":)" : "[";
+    }
+    nested += "1";
+    for (std::size_t k = 100; k-- > 0;) {
+        nested += k % 2 ? "}" : "]";
+    }
+    check(nested, error::none, 0);
 }
 
 #endif
@@ -2,12 +2,24 @@
 
 int main() {
     test_array();
+    test_binding();
     test_boolean();
+    test_document();
+    test_extract();
+    test_incremental();
+    test_index();
+    test_lines();
     test_null();
     test_number();
     test_object();
     test_parser();
+    test_query();
+    test_sax();
+    test_serializer();
     test_string();
+    test_tape();
+    test_utf8();
+    test_validate();
     test_value();
     return 0;
 }
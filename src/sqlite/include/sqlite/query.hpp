@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "sqlite3.h"
+#include "utf8/utf8.hpp"
 
 #include "exception.hpp"
 
@@ -153,12 +154,16 @@ public:
                 err << get_type_name(SQLITE_BLOB) << '|' << get_type_name(SQLITE_TEXT);
                 throw type_mismatch(checked_type, err.str().c_str());
             }
-            const int size = sqlite3_column_bytes(_stmt, index);
+            // blobs are returned as they are, only text is meant to be UTF-8
             const char *data = reinterpret_cast<const char*>(checked_type == SQLITE_BLOB ?
                 sqlite3_column_blob(_stmt, index) :
                 sqlite3_column_text(_stmt, index)
             );
-            return type{data, static_cast<std::size_t>(size)};
+            const auto size = static_cast<std::size_t>(sqlite3_column_bytes(_stmt, index));
+            if (checked_type == SQLITE_TEXT) {
+                check_utf8(data, size);
+            }
+            return type{data, size};
         }
     }
 
@@ -222,6 +227,15 @@ private:
         return exception{SQLITE_MISMATCH, err.str()};
     }
 
+    static void check_utf8(const char *data, const std::size_t size) {
+        if (const std::size_t offset = utf8::find_invalid(data, size); offset != size) {
+            std::ostringstream err;
+            err << exception{SQLITE_MISMATCH}.message();
+            err << ": invalid utf-8 text at offset " << offset;
+            throw exception{SQLITE_MISMATCH, err.str()};
+        }
+    }
+
     static exception range_error(const int index, const int size) {
         std::ostringstream err;
         err << exception{SQLITE_RANGE}.message();
@@ -53,4 +53,21 @@ void test_db_and_query() {
     assert(rows[2].second == "hjkl;");
 }
 
+void test_text_encoding() {
+    sqlite::db db;
+
+    sqlite::query q1 = db.prepare("select 'caf\xc3\xa9', x'ff', cast(x'636166c3' as text)");
+    assert(q1.first());
+    assert(q1.get<std::string>(0).value() == "caf\xc3\xa9");
+    assert(q1.get<std::string>(1).value() == "\xff");
+
+    bool thrown = false;
+    try {
+        q1.get<std::string_view>(2);
+    } catch (const sqlite::exception &e) {
+        thrown = e.code() == SQLITE_MISMATCH;
+    }
+    assert(thrown);
+}
+
 #endif
@@ -3,5 +3,6 @@
 int main() {
     test_exception();
     test_db_and_query();
+    test_text_encoding();
     return 0;
 }
@@ -0,0 +1,233 @@
+#ifndef UTF8_CHECKERS_HPP
+#define UTF8_CHECKERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpu.hpp"
+
+#ifdef UTF8_X86
+namespace utf8::tmp {
+
+// Classifies every byte by the high nibble of the byte before it, its low
+// nibble and the high nibble of the byte itself with three 16 entry tables
+// (Keiser and Lemire, "Validating UTF-8 in less than one instruction per
+// byte"), a byte is in error when the bits of the three lookups intersect.
+struct tables final {
+    static constexpr std::uint8_t too_short = 1 << 0;
+    static constexpr std::uint8_t too_long = 1 << 1;
+    static constexpr std::uint8_t overlong_3 = 1 << 2;
+    static constexpr std::uint8_t too_large = 1 << 3;
+    static constexpr std::uint8_t surrogate = 1 << 4;
+    static constexpr std::uint8_t overlong_2 = 1 << 5;
+    static constexpr std::uint8_t too_large_1000 = 1 << 6;
+    static constexpr std::uint8_t overlong_4 = 1 << 6;
+    static constexpr std::uint8_t two_continuations = 1 << 7;
+    static constexpr std::uint8_t carry = too_short | too_long | two_continuations;
+
+    alignas(16) static constexpr std::uint8_t byte_1_high[16] = {
+        // ASCII
+        too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+        // continuation
+        two_continuations, two_continuations, two_continuations, two_continuations,
+        // 110xxxxx
+        too_short | overlong_2,
+        too_short,
+        // 1110xxxx
+        too_short | overlong_3 | surrogate,
+        // 11110xxx
+        too_short | too_large | too_large_1000 | overlong_4
+    };
+
+    alignas(16) static constexpr std::uint8_t byte_1_low[16] = {
+        carry | overlong_3 | overlong_2 | overlong_4,
+        carry | overlong_2,
+        carry,
+        carry,
+        carry | too_large,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000 | surrogate,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000
+    };
+
+    alignas(16) static constexpr std::uint8_t byte_2_high[16] = {
+        // ASCII
+        too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+        // 1000xxxx
+        too_long | overlong_2 | two_continuations | overlong_3 | too_large_1000 | overlong_4,
+        // 1001xxxx
+        too_long | overlong_2 | two_continuations | overlong_3 | too_large,
+        // 101xxxxx
+        too_long | overlong_2 | two_continuations | surrogate | too_large,
+        too_long | overlong_2 | two_continuations | surrogate | too_large,
+        // 11xxxxxx
+        too_short, too_short, too_short, too_short
+    };
+
+    // a lead byte this close to the end of a block needs the next block
+    alignas(16) static constexpr std::uint8_t incomplete[16] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+    };
+
+    // the same for the 32 byte blocks, where only the last three bytes count
+    alignas(32) static constexpr std::uint8_t incomplete_32[32] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+    };
+};
+
+}
+#endif
+
+namespace utf8 {
+
+// The checkers skip whole blocks of valid UTF-8 and return where they stop,
+// at the first block holding or ending an invalid sequence or before the last
+// partial block, the bytes before are valid but for a sequence truncated there.
+struct scalar_checker final {
+    static std::size_t skip_valid(const char *, const std::size_t) {
+        return 0;
+    }
+};
+
+#ifdef UTF8_X86
+// The SIMD checkers are compiled for their instruction set whatever the
+// flags, default_checker only calls them when the CPU has it.
+struct ssse3_checker final {
+    static constexpr std::size_t block_size = 16;
+
+    [[gnu::target("ssse3")]] static std::size_t skip_valid(const char *p, const std::size_t n) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i previous = zero;
+        __m128i previous_incomplete = zero;
+        std::size_t i = 0;
+        for (; i + block_size <= n; i += block_size) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            // a sequence left incomplete by the previous block is an error in an ASCII one
+            __m128i error = previous_incomplete;
+            if (_mm_movemask_epi8(v) == 0) {
+                previous_incomplete = zero;
+            } else {
+                error = check(v, previous);
+                previous_incomplete = _mm_subs_epu8(v, table(tmp::tables::incomplete));
+            }
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xFFFF) {
+                return i;
+            }
+            previous = v;
+        }
+        return i;
+    }
+
+private:
+    [[gnu::target("ssse3")]] static inline __m128i table(const std::uint8_t (&t)[16]) {
+        return _mm_load_si128(reinterpret_cast<const __m128i*>(t));
+    }
+
+    [[gnu::target("ssse3")]] static inline __m128i high_nibbles(const __m128i v) {
+        return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+    }
+
+    [[gnu::target("ssse3")]] static inline __m128i check(const __m128i v, const __m128i previous) {
+        const __m128i previous_1 = _mm_alignr_epi8(v, previous, 15);
+        const __m128i special = _mm_and_si128(
+            _mm_and_si128(
+                _mm_shuffle_epi8(table(tmp::tables::byte_1_high), high_nibbles(previous_1)),
+                _mm_shuffle_epi8(table(tmp::tables::byte_1_low), _mm_and_si128(previous_1, _mm_set1_epi8(0x0F)))
+            ),
+            _mm_shuffle_epi8(table(tmp::tables::byte_2_high), high_nibbles(v))
+        );
+        // the third and fourth bytes of a sequence must be continuations
+        const __m128i third = _mm_subs_epu8(_mm_alignr_epi8(v, previous, 14), _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+        const __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(v, previous, 13), _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+        const __m128i must_continue = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+        return _mm_xor_si128(must_continue, special);
+    }
+};
+
+struct avx2_checker final {
+    static constexpr std::size_t block_size = 32;
+
+    [[gnu::target("avx2")]] static std::size_t skip_valid(const char *p, const std::size_t n) {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i previous = zero;
+        __m256i previous_incomplete = zero;
+        std::size_t i = 0;
+        for (; i + block_size <= n; i += block_size) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            __m256i error = previous_incomplete;
+            if (_mm256_movemask_epi8(v) == 0) {
+                previous_incomplete = zero;
+            } else {
+                error = check(v, previous);
+                previous_incomplete = _mm256_subs_epu8(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(tmp::tables::incomplete_32)));
+            }
+            if (!_mm256_testz_si256(error, error)) {
+                return i;
+            }
+            previous = v;
+        }
+        return i;
+    }
+
+private:
+    [[gnu::target("avx2")]] static inline __m256i table(const std::uint8_t (&t)[16]) {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t)));
+    }
+
+    [[gnu::target("avx2")]] static inline __m256i high_nibbles(const __m256i v) {
+        return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+    }
+
+    // the bytes of v shifted by k towards the end, the last ones of previous coming in
+    template <int k>
+    [[gnu::target("avx2")]] static inline __m256i shift(const __m256i v, const __m256i previous) {
+        return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(previous, v, 0x21), 16 - k);
+    }
+
+    [[gnu::target("avx2")]] static inline __m256i check(const __m256i v, const __m256i previous) {
+        const __m256i previous_1 = shift<1>(v, previous);
+        const __m256i special = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_shuffle_epi8(table(tmp::tables::byte_1_high), high_nibbles(previous_1)),
+                _mm256_shuffle_epi8(table(tmp::tables::byte_1_low), _mm256_and_si256(previous_1, _mm256_set1_epi8(0x0F)))
+            ),
+            _mm256_shuffle_epi8(table(tmp::tables::byte_2_high), high_nibbles(v))
+        );
+        const __m256i third = _mm256_subs_epu8(shift<2>(v, previous), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+        const __m256i fourth = _mm256_subs_epu8(shift<3>(v, previous), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+        const __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+        return _mm256_xor_si256(must_continue, special);
+    }
+};
+#endif
+
+// the widest checker the CPU can run
+struct default_checker final {
+    static std::size_t skip_valid(const char *p, const std::size_t n) {
+#ifdef UTF8_X86
+        if (cpu_has_avx2()) {
+            return avx2_checker::skip_valid(p, n);
+        }
+        if (cpu_has_ssse3()) {
+            return ssse3_checker::skip_valid(p, n);
+        }
+#endif
+        return scalar_checker::skip_valid(p, n);
+    }
+};
+
+}
+
+#endif
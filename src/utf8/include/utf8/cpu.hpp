@@ -0,0 +1,39 @@
+#ifndef UTF8_CPU_HPP
+#define UTF8_CPU_HPP
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_X86 1
+#include <immintrin.h>
+#endif
+
+namespace utf8 {
+
+// The SIMD checkers are compiled with target attributes whatever the flags
+// and picked at run time by these, which ask the CPU once.
+inline bool cpu_has_ssse3() {
+#ifdef UTF8_X86
+    static const bool supported = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+inline bool cpu_has_avx2() {
+#ifdef UTF8_X86
+    static const bool supported = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+}
+
+#endif
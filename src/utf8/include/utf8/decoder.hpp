@@ -0,0 +1,68 @@
+#ifndef UTF8_DECODER_HPP
+#define UTF8_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace utf8::tmp {
+
+inline constexpr bool is_continuation(const char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// Returns the index of the first byte of [p, p + n) starting an invalid,
+// overlong, surrogate or truncated UTF-8 sequence, or n when there is none.
+// Runs of ASCII are skipped eight bytes at a time.
+inline std::size_t decode(const char *p, const std::size_t n) {
+    std::size_t i = 0;
+    while (i < n) {
+        if (i + 8 <= n) {
+            std::uint64_t word;
+            std::memcpy(&word, p + i, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        const auto c = static_cast<unsigned char>(p[i]);
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        std::size_t size;
+        unsigned char low = 0x80;
+        unsigned char high = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) {
+            size = 2;
+        } else if (c >= 0xE0 && c <= 0xEF) {
+            size = 3;
+            low = c == 0xE0 ? 0xA0 : low;
+            high = c == 0xED ? 0x9F : high;
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            size = 4;
+            low = c == 0xF0 ? 0x90 : low;
+            high = c == 0xF4 ? 0x8F : high;
+        } else {
+            return i;
+        }
+        if (i + size > n) {
+            return i;
+        }
+        const auto second = static_cast<unsigned char>(p[i + 1]);
+        if (second < low || second > high) {
+            return i;
+        }
+        for (std::size_t j = 2; j < size; ++j) {
+            if (!is_continuation(p[i + j])) {
+                return i;
+            }
+        }
+        i += size;
+    }
+    return n;
+}
+
+}
+
+#endif
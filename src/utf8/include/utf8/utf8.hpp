@@ -0,0 +1,42 @@
+#ifndef UTF8_HPP
+#define UTF8_HPP
+
+#include <cstddef>
+#include <string_view>
+
+#include "checkers.hpp"
+#include "decoder.hpp"
+
+namespace utf8 {
+
+// Returns the index of the first byte of [p, p + n) starting an invalid,
+// overlong, surrogate or truncated UTF-8 sequence, or n when there is none.
+// The checker skips the valid blocks, the scalar decoder pinpoints the error
+// from the start of the sequence the checker stopped in and does the tail.
+template <typename checker = default_checker>
+inline std::size_t find_invalid(const char *p, const std::size_t n) {
+    const std::size_t i = checker::skip_valid(p, n);
+    std::size_t k = i < 3 ? 0 : i - 3;
+    for (; k < i && tmp::is_continuation(p[k]); ++k) {
+    }
+    return k + tmp::decode(p + k, n - k);
+}
+
+template <typename checker = default_checker>
+inline std::size_t find_invalid(const std::string_view s) {
+    return find_invalid<checker>(s.data(), s.size());
+}
+
+template <typename checker = default_checker>
+inline bool is_valid(const char *p, const std::size_t n) {
+    return find_invalid<checker>(p, n) == n;
+}
+
+template <typename checker = default_checker>
+inline bool is_valid(const std::string_view s) {
+    return is_valid<checker>(s.data(), s.size());
+}
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef TEST_UTF8_HPP
+#define TEST_UTF8_HPP
+
+#include <cassert>
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "utf8/utf8.hpp"
+
+namespace utf8::test {
+
+// every checker the CPU can run finds what the scalar decoder finds
+static std::size_t agree(const std::string_view s) {
+    const std::size_t expected = tmp::decode(s.data(), s.size());
+    assert(find_invalid<scalar_checker>(s) == expected);
+    assert(find_invalid(s) == expected);
+#ifdef UTF8_X86
+    if (cpu_has_ssse3()) {
+        assert(find_invalid<ssse3_checker>(s) == expected);
+    }
+    if (cpu_has_avx2()) {
+        assert(find_invalid<avx2_checker>(s) == expected);
+    }
+#endif
+    return expected;
+}
+
+}
+
+void test_find_invalid() {
+    const auto check = [](const std::string &s, const std::size_t expected) {
+        assert(utf8::test::agree(s) == expected);
+        assert(utf8::is_valid(s) == (expected == s.size()));
+    };
+    const std::string valid = "ascii caf\xc3\xa9 \xe2\x82\xac \xed\x9f\xbf \xef\xbf\xbf \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf";
+    static constexpr const char *invalid[] = {
+        "\x80", "\xbf", "\xc0\xaf", "\xc1\xbf", "\xc3", "\xc3\x28", "\xe0\x80\x80", "\xe0\x9f\xbf", "\xe2\x82",
+        "\xed\xa0\x80", "\xf0\x80\x80\x80", "\xf0\x9f\x98", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xfe", "\xff"
+    };
+    // every sequence at every position of the 16 and 32 byte blocks
+    for (std::size_t i = 0; i < 70; ++i) {
+        for (std::size_t size = i; size < i + 70; size += 23) {
+            std::string s(size, 'a');
+            s.replace(i, 0, valid);
+            check(s, s.size());
+            for (const char *bad : invalid) {
+                std::string b(size, 'a');
+                b.replace(i, 0, valid + bad);
+                check(b, i + valid.size());
+            }
+        }
+    }
+    check("", 0);
+    check("\xc3\xa9\xa9", 2);
+
+    // pieces of valid and invalid sequences glued at random
+    static constexpr const char *pieces[] = {
+        "a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\x80", "\xc3", "\xe2\x82", "\xed\xa0\x80", "\xff"
+    };
+    std::uint32_t seed = 12345;
+    for (int k = 0; k < 2000; ++k) {
+        std::string s;
+        while (s.size() < 100) {
+            seed = seed * 1664525 + 1013904223;
+            s += (seed >> 28) < 12 ? "abcdefgh" : pieces[(seed >> 16) % std::size(pieces)];
+        }
+        utf8::test::agree(s);
+    }
+}
+
+void test_skip_valid() {
+    assert(utf8::scalar_checker::skip_valid("abc", 3) == 0);
+
+    // a sequence ending in the middle of a block doesn't stop the checkers
+    for (std::size_t k = 0; k + 2 < 256; ++k) {
+        std::string s(256, 'a');
+        s.replace(k, 2, "\xc3\xa9");
+        assert(utf8::test::agree(s) == s.size());
+#ifdef UTF8_X86
+        if (utf8::cpu_has_ssse3()) {
+            assert(utf8::ssse3_checker::skip_valid(s.data(), s.size()) == s.size());
+        }
+        if (utf8::cpu_has_avx2()) {
+            assert(utf8::avx2_checker::skip_valid(s.data(), s.size()) == s.size());
+        }
+#endif
+    }
+
+    // the blocks before an invalid sequence are skipped, not the one holding it
+    std::string s(100, 'a');
+    s[40] = '\xff';
+#ifdef UTF8_X86
+    if (utf8::cpu_has_ssse3()) {
+        assert(utf8::ssse3_checker::skip_valid(s.data(), s.size()) == 32);
+    }
+    if (utf8::cpu_has_avx2()) {
+        assert(utf8::avx2_checker::skip_valid(s.data(), s.size()) == 32);
+    }
+#endif
+}
+
+#endif
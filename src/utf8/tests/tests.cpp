@@ -0,0 +1,7 @@
+#include "test_utf8.hpp"
+
+int main() {
+    test_find_invalid();
+    test_skip_valid();
+    return 0;
+}